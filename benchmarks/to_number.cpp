@@ -0,0 +1,45 @@
+#include "common.hpp"
+#include "assemble.hpp"
+
+/*
+    Times Assembler::ToNumber over a million mixed hex and binary
+    literals, the kind of operands the assembler spends its time on.
+*/
+
+namespace {
+
+    constexpr std::size_t LiteralCount = 1'000'000;
+    constexpr std::size_t Passes       = 10;
+
+}
+
+int main() {
+    std::vector<std::string> literals;
+    literals.reserve(LiteralCount);
+
+    for (const auto i : std::views::iota(std::size_t{0}, LiteralCount)) {
+        if (i % 3 == 0) {
+            literals.push_back("0x00000000000000AB");
+        } else if (i % 2 == 0) {
+            literals.push_back("0b10110101");
+        } else {
+            literals.push_back(fmt::format("0x{:02X}", i & 0xFF));
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    /* Summed so the parsing can't be optimised away. */
+    std::uint64_t sum = 0;
+    for ([[maybe_unused]] const auto pass : std::views::iota(std::size_t{0}, Passes)) {
+        for (const auto &literal : literals) {
+            sum += tsh::Assembler::ToNumber<std::uint64_t>(literal).value_or(1);
+        }
+    }
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    std::printf("Parsed %zu literals in %.3fs (checksum %llu)\n", LiteralCount * Passes, elapsed.count(), static_cast<unsigned long long>(sum));
+
+    return 0;
+}
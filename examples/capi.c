@@ -0,0 +1,51 @@
+/*
+    Drives a machine through the C interface from plain C, so the header
+    is known to work without a C++ compiler. Exits non-zero on failure.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <tshipate/tshipate.h>
+
+static const uint8_t Rom[] = {
+    0x00, 0xE0, /* CLS           */
+    0xF0, 0x29, /* LD F, V0      */
+    0xD0, 0x15, /* DRW V0, V1, 5 */
+    0x12, 0x06, /* JP 0x206      */
+};
+
+static int Check(const int ok, const char *what) {
+    if (!ok) {
+        printf("Failed: %s\n", what);
+    }
+
+    return ok;
+}
+
+int main(void) {
+    tsh_machine *machine = tsh_create(Rom, sizeof(Rom), 0);
+    if (!Check(machine != NULL, "create")) {
+        return 1;
+    }
+
+    int ok = Check(tsh_step(machine, 2) == 2, "step");
+
+    /* The top row of the 0 digit, drawn at the top left corner. */
+    const uint64_t *framebuffer = tsh_framebuffer(machine);
+    ok = ok && Check(framebuffer != NULL && framebuffer[0] >> 56 == 0xF0, "framebuffer");
+
+    ok = ok && Check(tsh_fault(machine) == TSHIPATE_FAULT_NONE, "fault");
+    ok = ok && Check(tsh_cycles(machine) > 0, "cycles");
+
+    uint8_t *state = malloc(tsh_state_size());
+    ok = ok && Check(state != NULL, "allocate state");
+    ok = ok && Check(tsh_save_state(machine, state, tsh_state_size()) == 0, "save state");
+    ok = ok && Check(tsh_load_state(machine, state, tsh_state_size()) == 0, "load state");
+    ok = ok && Check(tsh_load_state(machine, state, 1) != 0, "reject short state");
+
+    free(state);
+    tsh_destroy(machine);
+
+    return ok ? 0 : 1;
+}
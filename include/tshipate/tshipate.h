@@ -0,0 +1,84 @@
+#ifndef TSHIPATE_H
+#define TSHIPATE_H
+
+/*
+    Plain C interface for running a machine in process, without a window.
+
+    Nothing here is thread safe on a single machine, but separate
+    machines can be driven from separate threads.
+
+    No C++ exception ever reaches the caller. The functions which can
+    fail inside, tsh_create, tsh_step and the save state functions, give
+    back their usual failure value instead: NULL, -1, or for tsh_step
+    the frames run before it.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(TSHIPATE_BUILDING_LIBRARY)
+    #define TSHIPATE_API __attribute__((visibility("default")))
+#else
+    #define TSHIPATE_API
+#endif
+
+/* Lets C++ callers see that nothing here throws. */
+#ifdef __cplusplus
+    #define TSHIPATE_NOEXCEPT noexcept
+#else
+    #define TSHIPATE_NOEXCEPT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TSHIPATE_DISPLAY_WIDTH  64
+#define TSHIPATE_DISPLAY_HEIGHT 32
+
+/* Reasons a machine can stop, as returned by tsh_fault. */
+#define TSHIPATE_FAULT_NONE            0
+#define TSHIPATE_FAULT_STACK_OVERFLOW  1
+#define TSHIPATE_FAULT_STACK_UNDERFLOW 2
+#define TSHIPATE_FAULT_UNKNOWN_OPCODE  3
+
+typedef struct tsh_machine tsh_machine;
+
+/* Copies the rom, so it can be freed straight away. Returns NULL if the rom is too big or allocation fails. */
+TSHIPATE_API tsh_machine *tsh_create(const uint8_t *rom, size_t size, uint64_t seed) TSHIPATE_NOEXCEPT;
+
+TSHIPATE_API void tsh_destroy(tsh_machine *machine) TSHIPATE_NOEXCEPT;
+
+/* Bit n is set while key n (0x0 to 0xF) is held. Takes effect from the next frame. */
+TSHIPATE_API void tsh_set_keys(tsh_machine *machine, uint16_t pressed_keys) TSHIPATE_NOEXCEPT;
+
+/* Returns how many frames were run, which is less than asked for once the machine faults. */
+TSHIPATE_API size_t tsh_step(tsh_machine *machine, size_t frames) TSHIPATE_NOEXCEPT;
+
+/*
+    The machine's own display, not a copy, so it changes as frames are
+    stepped and stays valid until the machine is destroyed.
+
+    One 64 bit row per line, top to bottom, with the leftmost pixel in
+    the most significant bit.
+*/
+TSHIPATE_API const uint64_t *tsh_framebuffer(const tsh_machine *machine) TSHIPATE_NOEXCEPT;
+
+/* Zero while running, otherwise the reason the machine stopped. */
+TSHIPATE_API int tsh_fault(const tsh_machine *machine) TSHIPATE_NOEXCEPT;
+
+/* Instructions executed so far. */
+TSHIPATE_API uint64_t tsh_cycles(const tsh_machine *machine) TSHIPATE_NOEXCEPT;
+
+/* Every save state is exactly this big. */
+TSHIPATE_API size_t tsh_state_size(void) TSHIPATE_NOEXCEPT;
+
+/* Both return zero on success. */
+TSHIPATE_API int tsh_save_state(const tsh_machine *machine, uint8_t *out, size_t size) TSHIPATE_NOEXCEPT;
+TSHIPATE_API int tsh_load_state(tsh_machine *machine, const uint8_t *in, size_t size) TSHIPATE_NOEXCEPT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
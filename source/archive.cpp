@@ -0,0 +1,138 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "archive.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        /* Offsets into a tar header block. */
+        constexpr std::size_t NameOffset     = 0;
+        constexpr std::size_t NameSize       = 100;
+        constexpr std::size_t SizeOffset     = 124;
+        constexpr std::size_t SizeSize       = 12;
+        constexpr std::size_t TypeFlagOffset = 156;
+
+        constexpr char RegularFile    = '0';
+        constexpr char OldRegularFile = '\0';
+        constexpr char GnuLongName    = 'L';
+
+        /* Fields are NUL-terminated unless they fill their whole space. */
+        std::string_view HeaderString(const std::byte *field, const std::size_t size) {
+            const auto str = std::string_view(reinterpret_cast<const char *>(field), size);
+
+            return str.substr(0, str.find('\0'));
+        }
+
+        std::optional<std::size_t> HeaderOctal(const std::byte *field, const std::size_t size) {
+            auto str = HeaderString(field, size);
+
+            /* Some writers pad with spaces. */
+            while (!str.empty() && str.front() == ' ') {
+                str.remove_prefix(1);
+            }
+
+            while (!str.empty() && str.back() == ' ') {
+                str.remove_suffix(1);
+            }
+
+            std::size_t value = 0;
+            if (std::from_chars(str.data(), str.data() + str.size(), value, 8).ec != std::errc()) {
+                return {};
+            }
+
+            return value;
+        }
+
+        ALWAYS_INLINE bool IsZeroBlock(const std::span<const std::byte> block) {
+            return std::ranges::all_of(block, [](const std::byte byte) { return byte == std::byte{}; });
+        }
+
+        ALWAYS_INLINE constexpr std::size_t RoundToBlock(const std::size_t size) {
+            return (size + RomArchive::BlockSize - 1) / RomArchive::BlockSize * RomArchive::BlockSize;
+        }
+
+    }
+
+    bool RomArchive::Open(const std::string &path) {
+        this->entries.clear();
+        this->by_hash.clear();
+
+        if (!this->file.Open(path)) {
+            return false;
+        }
+
+        const auto archive = this->file.Span();
+
+        std::optional<std::string_view> long_name;
+
+        std::size_t offset = 0;
+        while (archive.size() - offset >= BlockSize) {
+            const auto header = archive.subspan(offset, BlockSize);
+
+            /* The archive ends with zeroed blocks. */
+            if (IsZeroBlock(header)) {
+                break;
+            }
+
+            const auto size = HeaderOctal(header.data() + SizeOffset, SizeSize);
+            if (!size.has_value()) {
+                return false;
+            }
+
+            offset += BlockSize;
+
+            if (archive.size() - offset < *size) {
+                return false;
+            }
+
+            const auto data = archive.subspan(offset, *size);
+            const auto type = static_cast<char>(header[TypeFlagOffset]);
+
+            offset += std::min(RoundToBlock(*size), archive.size() - offset);
+
+            /* GNU tar stores names too long for the header in a pseudo-entry before the real one. */
+            if (type == GnuLongName) {
+                long_name = HeaderString(data.data(), data.size());
+                continue;
+            }
+
+            /* Skip directories, links and extended headers. */
+            if (type != RegularFile && type != OldRegularFile) {
+                long_name.reset();
+                continue;
+            }
+
+            const auto name = long_name.value_or(HeaderString(header.data() + NameOffset, NameSize));
+            long_name.reset();
+
+            const auto hash = util::Hash64(data);
+
+            /* Identical roms under different names are only indexed by hash once. */
+            this->by_hash.try_emplace(hash, this->entries.size());
+
+            this->entries.push_back(Entry{name, data, hash});
+        }
+
+        return true;
+    }
+
+    const RomArchive::Entry *RomArchive::Find(const std::uint64_t hash) const {
+        const auto it = this->by_hash.find(hash);
+        if (it == this->by_hash.end()) {
+            return nullptr;
+        }
+
+        return &this->entries[it->second];
+    }
+
+    const RomArchive::Entry *RomArchive::Find(const std::string_view name) const {
+        const auto it = std::ranges::find(this->entries, name, &Entry::name);
+        if (it == this->entries.end()) {
+            return nullptr;
+        }
+
+        return &*it;
+    }
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+
+namespace tsh {
+
+    /*
+        Many roms packed back to back in a plain tar file, all
+        viewed through a single mapping and indexed by the hash
+        of their contents.
+    */
+    class RomArchive {
+        NON_COPYABLE(RomArchive);
+        NON_MOVEABLE(RomArchive);
+
+        public:
+            static constexpr std::size_t BlockSize = 512;
+
+            struct Entry {
+                std::string_view name;
+                std::span<const std::byte> data;
+
+                /* XXH64 of the data. */
+                std::uint64_t hash;
+            };
+
+            util::MappedFile file;
+
+            std::vector<Entry> entries;
+            std::unordered_map<std::uint64_t, std::size_t> by_hash;
+
+            ALWAYS_INLINE RomArchive() = default;
+
+            [[nodiscard]]
+            bool Open(const std::string &path);
+
+            [[nodiscard]]
+            const Entry *Find(const std::uint64_t hash) const;
+
+            [[nodiscard]]
+            const Entry *Find(const std::string_view name) const;
+
+            ALWAYS_INLINE auto begin() const {
+                return this->entries.begin();
+            }
+
+            ALWAYS_INLINE auto end() const {
+                return this->entries.end();
+            }
+
+            ALWAYS_INLINE auto size() const {
+                return this->entries.size();
+            }
+    };
+
+}
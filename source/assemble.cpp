@@ -1,80 +1,182 @@
 #include "common.hpp"
 #include "assemble.hpp"
+#include "expand.hpp"
+#include "peephole.hpp"
 #include "chip8.hpp"
 
 namespace tsh {
 
     namespace {
 
-        std::string TrimWhitespace(const std::string_view str) {
-            /* Without our own function we get unresolved overloads. */
-            static constexpr auto resolved_isspace = [](char c) {
-                return static_cast<bool>(std::isspace(c));
-            };
+        /* Every line is a view into the code, without its comment or surrounding whitespace. */
+        std::vector<std::string_view> TrimmedLines(std::string_view code) {
+            std::vector<std::string_view> lines;
 
-            auto view = str |
-                std::views::drop_while(resolved_isspace) |
-                std::views::reverse                      |
-                std::views::drop_while(resolved_isspace) |
-                std::views::reverse;
+            while (!code.empty()) {
+                const auto line_end = std::min(code.find('\n'), code.size());
 
-            return std::string(std::ranges::begin(view), std::ranges::end(view));
+                auto line = code.substr(0, line_end);
+                code.remove_prefix(std::min(line_end + 1, code.size()));
+
+                line = line.substr(0, line.find(Assembler::CommentPrefix));
+                line = Statement::Trim(line);
+
+                if (!line.empty()) {
+                    lines.push_back(line);
+                }
+            }
+
+            return lines;
         }
 
-        std::vector<std::string> TrimmedLines(const std::string_view code) {
-            std::vector<std::string> lines;
+        /*
+            Statements encoded by one task. Tens of microseconds of work
+            against about one to hand it out, and a full program space of
+            instructions still splits into several.
+        */
+        constexpr std::size_t ChunkStatements = 256;
 
-            for (const auto line_rng : code | std::views::split('\n')) {
-                /*
-                    GCC 11.1 and 11.2 choke up on string_view and string constructors for iterators.
-                    Even std::views::common doesn't fix it.
+        std::optional<Assembler::Layout> LayOut(const std::string_view code, const bool optimize) {
+            Assembler::Layout layout;
 
-                    TODO: Make this not garbage.
-                */
-                const auto line = [&]() {
-                    std::string line;
-                    std::ranges::copy(line_rng, std::back_inserter(line));
+            layout.code = code;
 
-                    const auto comment_pos = line.find(Assembler::CommentPrefix);
+            const auto source_lines = TrimmedLines(code);
 
-                    if (comment_pos != std::string::npos) {
-                        line.erase(comment_pos);
+            /* Directives are expanded as the source is lexed, so the label pass only sees plain statements. */
+            layout.statements.reserve(source_lines.size());
+            layout.lines.reserve(source_lines.size());
+
+            auto expander = Expander(source_lines, layout.statements, layout.lines);
+            if (!expander.Expand()) {
+                return {};
+            }
+
+            layout.constants = std::move(expander.constants);
+
+            if (optimize) {
+                Peephole::Optimize(layout.statements, layout.lines);
+            }
+
+            layout.offsets.reserve(layout.statements.size());
+
+            for (const auto &&[i, statement] : util::enumerate(layout.statements)) {
+                layout.offsets.push_back(layout.size);
+
+                if (statement.IsLabel()) {
+                    /* Also catches labels inside bodies expanded more than once. */
+                    if (!layout.labels.try_emplace(statement.Label(), Chip8::ProgramSpace.start + layout.size).second) {
+                        fmt::print("Duplicate label: {}\n", layout.lines[i]);
+                        return {};
                     }
 
-                    return TrimWhitespace(line);
-                }();
+                    continue;
+                }
 
-                if (!line.empty()) {
-                    lines.push_back(line);
+                layout.size += Assembler::SizeForInstruction(statement);
+            }
+
+            return layout;
+        }
+
+        /* Gives back the statement which failed to encode, if any. */
+        std::optional<std::size_t> EncodeChunk(const Assembler &asmbl, const Assembler::Layout &layout, const std::span<std::byte> out, const std::size_t chunk) {
+            const auto first = chunk * ChunkStatements;
+            const auto last  = std::min(first + ChunkStatements, layout.statements.size());
+
+            auto offset = layout.offsets[first];
+
+            for (const auto i : std::views::iota(first, last)) {
+                const auto &statement = layout.statements[i];
+                if (statement.IsLabel()) {
+                    continue;
                 }
 
+                const auto size = Chip8::Instructions::Assemble(asmbl, statement, out.subspan(offset));
+                if (!size.has_value()) {
+                    return i;
+                }
+
+                offset += *size;
             }
 
-            return lines;
+            return {};
+        }
+
+        /* Whether an operand is one of the names, or an expression using one. */
+        bool ReferencesAny(const std::string_view operand, const std::unordered_set<std::string_view> &names) {
+            if (names.empty()) {
+                return false;
+            }
+
+            return names.contains(operand) || Expression::AnyAtom(operand, [&](const std::string_view atom) {
+                return names.contains(atom);
+            });
+        }
+
+        bool ReferencesAny(const Statement &statement, const std::unordered_set<std::string_view> &names) {
+            return std::ranges::any_of(std::span(statement.operands.data(), statement.operand_count), [&](const std::string_view operand) {
+                return ReferencesAny(operand, names);
+            });
         }
 
-        ALWAYS_INLINE constexpr bool IsLabel(const std::string_view line) {
-            return line.ends_with(':');
+        /* Names which appeared, vanished or changed value between two tables. */
+        template<typename T>
+        void InsertChanged(std::unordered_set<std::string_view> &changed, const std::unordered_map<std::string_view, T> &before, const std::unordered_map<std::string_view, T> &after) {
+            for (const auto &[name, value] : after) {
+                const auto it = before.find(name);
+                if (it == before.end() || it->second != value) {
+                    changed.insert(name);
+                }
+            }
+
+            for (const auto &[name, value] : before) {
+                if (!after.contains(name)) {
+                    changed.insert(name);
+                }
+            }
         }
 
-        std::unordered_map<std::string_view, Address> ParseLabels(const std::vector<std::string> &lines) {
-            std::unordered_map<std::string_view, Address> labels;
-            Address current_addr = Chip8::ProgramSpace.start;
+        /*
+            Every label is known by now, so each chunk only depends on
+            its own statements and can be encoded at its own offset.
+        */
+        std::optional<std::size_t> Encode(Assembler &asmbl, const Assembler::Layout &layout, const std::span<std::byte> out) {
+            if (layout.size > out.size()) {
+                fmt::print("Program needs {} bytes but only {} are available\n", layout.size, out.size());
+                return {};
+            }
 
-            for (const auto &line : lines) {
-                if (IsLabel(line)) {
-                    auto label = std::string_view(line);
-                    label.remove_suffix(1);
+            const auto chunk_count = (layout.statements.size() + ChunkStatements - 1) / ChunkStatements;
 
-                    labels[label] = current_addr;
+            auto failures = std::vector<std::optional<std::size_t>>(chunk_count);
 
-                    continue;
+            if (!asmbl.jobs.has_value() || chunk_count <= 1) {
+                for (const auto chunk : std::views::iota(std::size_t{0}, chunk_count)) {
+                    failures[chunk] = EncodeChunk(asmbl, layout, out, chunk);
+                }
+            } else {
+                if (!asmbl.pool.has_value()) {
+                    asmbl.pool.emplace(*asmbl.jobs);
                 }
 
-                current_addr += Assembler::SizeForInstruction(line);
+                for (const auto chunk : std::views::iota(std::size_t{0}, chunk_count)) {
+                    asmbl.pool->Submit([&asmbl, &layout, out, &failures, chunk]() {
+                        failures[chunk] = EncodeChunk(asmbl, layout, out, chunk);
+                    });
+                }
+
+                asmbl.pool->Wait();
+            }
+
+            /* Report the earliest failure, as encoding in order would have. */
+            const auto failure = std::ranges::find_if(failures, [](const auto &failure) { return failure.has_value(); });
+            if (failure != failures.end()) {
+                fmt::print("Failed to assemble instruction: {}\n", layout.lines[**failure]);
+                return {};
             }
 
-            return labels;
+            return layout.size;
         }
 
     }
@@ -84,67 +186,262 @@ namespace tsh {
             return {};
         }
 
-        /* Try to find a label first. If that fails, interpret literal address. */
+        /* Try to find a label first. If that fails, evaluate it. */
         const auto it = this->labels.find(address);
         if (it != this->labels.end()) {
             return it->second;
         }
 
-        return ToNumber<Address>(address);
+        const auto value = this->Evaluate(address);
+        if (!value.has_value() || *value < 0 || *value > std::numeric_limits<Address>::max()) {
+            return {};
+        }
+
+        return static_cast<Address>(*value);
     }
 
-    std::optional<std::vector<std::byte>> Assembler::Assemble(const std::string_view code) {
-        const auto lines = TrimmedLines(code);
-        this->labels     = ParseLabels(lines);
+    std::optional<std::uint8_t> Assembler::ToByte(const std::string_view byte) const {
+        const auto value = this->Evaluate(byte);
+        if (!value.has_value() || *value < 0 || *value > std::numeric_limits<std::uint8_t>::max()) {
+            return {};
+        }
 
-        std::vector<std::byte> program;
+        return static_cast<std::uint8_t>(*value);
+    }
 
-        for (const auto &line : lines) {
-            if (IsLabel(line)) {
-                continue;
+    std::optional<Expression::Value> Assembler::Evaluate(const std::string_view expression, const std::size_t depth) const {
+        if (depth == Expression::MaxDepth) {
+            return {};
+        }
+
+        return Expression::Evaluate(expression, [&](const std::string_view atom) -> std::optional<Expression::Value> {
+            const auto label = this->labels.find(atom);
+            if (label != this->labels.end()) {
+                return label->second;
+            }
+
+            const auto constant = this->constants.find(atom);
+            if (constant != this->constants.end()) {
+                return this->Evaluate(constant->second, depth + 1);
             }
 
-            const auto data = Chip8::Instructions::Assemble(*this, line);
-            if (!data.has_value()) {
-                fmt::print("Failed to assemble instruction: {}\n", line);
+            const auto number = ToNumber<std::uint64_t>(atom);
+            if (!number.has_value() || *number > static_cast<std::uint64_t>(std::numeric_limits<Expression::Value>::max())) {
                 return {};
             }
 
-            program.insert(program.end(), data->begin(), data->end());
+            return static_cast<Expression::Value>(*number);
+        });
+    }
+
+    std::optional<std::size_t> Assembler::Assemble(const std::string_view code, const std::span<std::byte> out) {
+        auto layout = LayOut(code, this->optimize);
+        if (!layout.has_value()) {
+            return {};
         }
 
-        return program;
+        this->labels    = layout->labels;
+        this->constants = layout->constants;
+        this->layout    = std::move(*layout);
+
+        this->layout_watched = false;
+
+        return Encode(*this, this->layout, out);
     }
 
-    std::optional<std::vector<std::byte>> Assembler::AssembleFromFile(const std::string &path) {
-        const auto fp = std::fopen(path.c_str(), "r");
-        if (fp == nullptr) {
+    std::optional<std::vector<std::byte>> Assembler::Assemble(const std::string_view code) {
+        auto layout = LayOut(code, this->optimize);
+        if (!layout.has_value()) {
             return {};
         }
 
-        ON_SCOPE_EXIT { std::fclose(fp); };
+        this->labels    = layout->labels;
+        this->constants = layout->constants;
+        this->layout    = std::move(*layout);
+
+        this->layout_watched = false;
+
+        /* Sized up front so instructions are encoded in place. */
+        auto program = std::vector<std::byte>(this->layout.size);
 
-        if (std::fseek(fp, 0, SEEK_END) != 0) {
+        const auto size = Encode(*this, this->layout, program);
+        if (!size.has_value()) {
             return {};
         }
 
-        const auto offset = std::ftell(fp);
-        if (offset < 0) {
+        program.resize(*size);
+
+        return program;
+    }
+
+    std::optional<std::vector<std::byte>> Assembler::AssembleFromFile(const std::string &path) {
+        /* Labels point into the mapping, so it is kept open alongside them. */
+        if (!this->source.Open(path)) {
             return {};
         }
 
-        const auto size = static_cast<std::size_t>(offset);
+        return this->Assemble(std::string_view(reinterpret_cast<const char *>(this->source.data), this->source.size));
+    }
+
+    std::optional<std::span<const std::byte>> Assembler::Reassemble(const std::string_view code) {
+        const auto next_source = this->current_source ^ 1;
+        this->watched_sources[next_source].assign(code);
 
-        if (std::fseek(fp, 0, SEEK_SET) != 0) {
+        auto layout = LayOut(this->watched_sources[next_source], this->optimize);
+        if (!layout.has_value()) {
             return {};
         }
 
-        auto code = std::string(size, '\0');
-        if (std::fread(code.data(), size, 1, fp) != 1) {
+        /* A build from Assemble has no program here to reuse, and its views may not outlive it. */
+        const auto nothing_watched = Layout{};
+        const auto &previous       = this->layout_watched ? this->layout : nothing_watched;
+
+        /*
+            An edit touches one stretch of statements, and those either side of it are unchanged.
+            Statements are compared after expansion, so changing a constant or macro counts as
+            changing everything that uses it.
+        */
+        const auto &statements          = layout->statements;
+        const auto &previous_statements = previous.statements;
+
+        const auto common = std::min(statements.size(), previous_statements.size());
+
+        std::size_t prefix = 0;
+        while (prefix < common && statements[prefix] == previous_statements[prefix]) {
+            prefix++;
+        }
+
+        std::size_t suffix = 0;
+        while (suffix < common - prefix && statements[statements.size() - suffix - 1] == previous_statements[previous_statements.size() - suffix - 1]) {
+            suffix++;
+        }
+
+        /* Labels and constants which appeared, vanished or changed. Anything naming them is encoded again. */
+        std::unordered_set<std::string_view> moved;
+        InsertChanged(moved, previous.labels, layout->labels);
+        InsertChanged(moved, previous.constants, layout->constants);
+
+        /* Constants defined in terms of changed names change with them. */
+        for ([[maybe_unused]] const auto pass : std::views::iota(std::size_t{0}, Expression::MaxDepth)) {
+            const auto before = moved.size();
+
+            for (const auto &[name, value] : layout->constants) {
+                if (ReferencesAny(value, moved)) {
+                    moved.insert(name);
+                }
+            }
+
+            if (moved.size() == before) {
+                break;
+            }
+        }
+
+        this->labels    = layout->labels;
+        this->constants = layout->constants;
+
+        auto program = std::vector<std::byte>(layout->size);
+
+        std::size_t reencoded = 0;
+
+        for (const auto &&[i, statement] : util::enumerate(layout->statements)) {
+            if (statement.IsLabel()) {
+                continue;
+            }
+
+            const auto offset = layout->offsets[i];
+
+            const auto previous_index = [&]() -> std::optional<std::size_t> {
+                if (i < prefix) {
+                    return i;
+                }
+
+                if (i >= layout->statements.size() - suffix) {
+                    return i + previous.statements.size() - layout->statements.size();
+                }
+
+                return {};
+            }();
+
+            if (previous_index.has_value() && !ReferencesAny(statement, moved)) {
+                const auto previous_offset = previous.offsets[*previous_index];
+
+                std::copy_n(this->watched_program.begin() + previous_offset, SizeForInstruction(statement), program.begin() + offset);
+                continue;
+            }
+
+            if (!Chip8::Instructions::Assemble(*this, statement, std::span(program).subspan(offset)).has_value()) {
+                fmt::print("Failed to assemble instruction: {}\n", layout->lines[i]);
+
+                /* Keep the last good build to work from. */
+                this->labels    = previous.labels;
+                this->constants = previous.constants;
+                return {};
+            }
+
+            reencoded++;
+        }
+
+        this->layout          = std::move(*layout);
+        this->layout_watched  = true;
+        this->watched_program = std::move(program);
+        this->current_source  = next_source;
+        this->reencoded       = reencoded;
+
+        return std::span<const std::byte>(this->watched_program);
+    }
+
+    std::optional<std::span<const std::byte>> Assembler::ReassembleFromFile(const std::string &path) {
+        /* The text is copied, since the file may be rewritten under the mapping before the next build. */
+        util::MappedFile file;
+        if (!file.Open(path)) {
             return {};
         }
 
-        return this->Assemble(code);
+        return this->Reassemble(std::string_view(reinterpret_cast<const char *>(file.data), file.size));
+    }
+
+    bool Assembler::WriteSymbols(const std::string &path, const std::string_view source_name) const {
+        const auto fp = std::fopen(path.c_str(), "w");
+        if (fp == nullptr) {
+            return false;
+        }
+
+        ON_SCOPE_EXIT { std::fclose(fp); };
+
+        auto labels = std::vector<std::pair<Address, std::string_view>>();
+        labels.reserve(this->labels.size());
+
+        for (const auto &[name, address] : this->labels) {
+            labels.emplace_back(address, name);
+        }
+
+        std::ranges::sort(labels);
+
+        for (const auto &[address, name] : labels) {
+            fmt::print(fp, "label {:04X} {}\n", address, name);
+        }
+
+        /* Line numbers come from where each line sits in the source. */
+        std::vector<std::size_t> newlines;
+        for (const auto &&[offset, c] : util::enumerate(this->layout.code)) {
+            if (c == '\n') {
+                newlines.push_back(offset);
+            }
+        }
+
+        /* Each line covers the bytes up to the next one. */
+        for (const auto &&[i, statement] : util::enumerate(this->layout.statements)) {
+            if (statement.IsLabel() || SizeForInstruction(statement) == 0) {
+                continue;
+            }
+
+            const auto offset = static_cast<std::size_t>(this->layout.lines[i].data() - this->layout.code.data());
+            const auto line   = std::ranges::upper_bound(newlines, offset) - newlines.begin() + 1;
+
+            fmt::print(fp, "line {:04X} {}:{}\n", Chip8::ProgramSpace.start + this->layout.offsets[i], source_name, line);
+        }
+
+        return std::ferror(fp) == 0;
     }
 
 }
@@ -3,6 +3,7 @@
 #include "common.hpp"
 #include "util.hpp"
 #include "instruction.hpp"
+#include "expression.hpp"
 #include "chip8.hpp"
 
 namespace tsh {
@@ -14,9 +15,38 @@ namespace tsh {
         public:
             static constexpr std::string_view CommentPrefix = "//";
 
+            struct Layout {
+                std::string_view code;
+
+                /* Views into the code. */
+                std::vector<std::string_view> lines;
+                std::vector<Statement> statements;
+
+                std::unordered_map<std::string_view, Address> labels;
+
+                /* Text of every .equ, evaluated wherever it is used. */
+                std::unordered_map<std::string_view, std::string_view> constants;
+
+                /* Where each statement starts in the program. */
+                std::vector<std::size_t> offsets;
+
+                /* Bytes taken up by the whole program. */
+                std::size_t size = 0;
+            };
+
+            [[nodiscard]]
+            static constexpr Address SizeForInstruction(const Statement &ins) {
+                return Chip8::Instructions::Size(ins.mnemonic);
+            }
+
             [[nodiscard]]
             static constexpr Address SizeForInstruction(const std::string_view ins) {
-                return Chip8::Instructions::Size(ins);
+                const auto statement = Statement::Lex(ins);
+                if (!statement.has_value()) {
+                    return 0;
+                }
+
+                return SizeForInstruction(*statement);
             }
 
             template<std::integral T>
@@ -26,63 +56,55 @@ namespace tsh {
 
                 const auto base = [&]() {
                     if (str.starts_with("0x")) {
-                        return std::size_t{16};
+                        return T{16};
                     }
 
                     if (str.starts_with("0b")) {
-                        return std::size_t{2};
+                        return T{2};
                     }
 
                     if (str.starts_with("0o")) {
-                        return std::size_t{8};
+                        return T{8};
                     }
 
-                    return std::size_t{10};
+                    return T{10};
                 }();
 
                 if (base != 10) {
                     str = str.substr(2);
                 }
 
-                const char upper_char = std::min(static_cast<char>('0' + base), '9');
-
-                T parsed = {};
-
-                /* Macro to protect from overflowing. */
-                #define SAFE_ADD(to_add) ({             \
-                    const T _to_add = (to_add);         \
-                    if (MaxNumber - _to_add < parsed) { \
-                        return {};                      \
-                    }                                   \
-                    parsed += _to_add;                  \
-                })
-
-                for (const auto &&[i, c] : util::enumerate(str)) {
-                    const auto place = util::pow(base, str.size() - i - 1);
-
-                    if (c >= '0' && c <= upper_char) {
-                        SAFE_ADD(place * ((c - '0') + 0));
-                        continue;
-                    }
-
-                    if (base != 16) {
-                        return {};
+                const auto digit_value = [](const char c) -> std::optional<T> {
+                    if (c >= '0' && c <= '9') {
+                        return (c - '0') + 0x0;
                     }
 
                     if (c >= 'a' && c <= 'f') {
-                        SAFE_ADD(place * ((c - 'a') + 0xa));
-                        continue;
+                        return (c - 'a') + 0xa;
                     }
 
                     if (c >= 'A' && c <= 'F') {
-                        SAFE_ADD(place * ((c - 'A') + 0xA));
-                        continue;
+                        return (c - 'A') + 0xA;
                     }
 
                     return {};
-                }
+                };
+
+                T parsed = {};
+
+                /* One multiply and add per digit, refusing anything which would overflow. */
+                for (const char c : str) {
+                    const auto digit = digit_value(c);
+                    if (!digit.has_value() || *digit >= base) {
+                        return {};
+                    }
+
+                    if (parsed > (MaxNumber - *digit) / base) {
+                        return {};
+                    }
 
-                #undef SAFE_ADD
+                    parsed = parsed * base + *digit;
+                }
 
                 return parsed;
             }
@@ -106,23 +128,84 @@ namespace tsh {
                 return {};
             }
 
+            /* Source being assembled from a file. Lines and labels are views into it. */
+            util::MappedFile source;
+
             std::unordered_map<std::string_view, Address> labels;
+            std::unordered_map<std::string_view, std::string_view> constants;
+
+            /* Whether to run the peephole pass before laying out the program. */
+            bool optimize = false;
+
+            /* Threads to encode programs of more than one chunk on when set, zero for one per core. */
+            std::optional<std::size_t> jobs;
+
+            /* Started the first time a program has more than one chunk, so small ones never pay for threads. */
+            std::optional<util::ThreadPool> pool;
+
+            /* The last build. Its views are only valid as long as the code it was built from. */
+            Layout layout;
+
+            /*
+                Kept for watch mode to work from. Sources alternate between
+                two buffers, so the previous layout still points at its own
+                text while the next one is laid out.
+            */
+            std::array<std::string, 2> watched_sources;
+            std::size_t current_source = 0;
+
+            std::vector<std::byte> watched_program;
+
+            /* Whether the last build was a rebuild, so its layout matches the watched program and sources. */
+            bool layout_watched = false;
+
+            /* Statements actually encoded by the last rebuild. */
+            std::size_t reencoded = 0;
+
+            /* Folds an expression over numbers, labels and constants. */
+            [[nodiscard]]
+            std::optional<Expression::Value> Evaluate(const std::string_view expression, const std::size_t depth = 0) const;
 
             [[nodiscard]]
             std::optional<Address> ToAddress(const std::string_view address) const;
 
+            [[nodiscard]]
+            std::optional<std::uint8_t> ToByte(const std::string_view byte) const;
+
             ALWAYS_INLINE Assembler() = default;
 
+            /* Encodes straight into the output, giving back how many bytes were written. */
+            [[nodiscard]]
+            std::optional<std::size_t> Assemble(const std::string_view code, const std::span<std::byte> out);
+
             [[nodiscard]]
             std::optional<std::vector<std::byte>> Assemble(const std::string_view code);
 
             [[nodiscard]]
             std::optional<std::vector<std::byte>> AssembleFromFile(const std::string &path);
+
+            /* Reuses the encoding of every statement which neither changed nor names a label that moved. */
+            [[nodiscard]]
+            std::optional<std::span<const std::byte>> Reassemble(const std::string_view code);
+
+            [[nodiscard]]
+            std::optional<std::span<const std::byte>> ReassembleFromFile(const std::string &path);
+
+            /* Writes the labels and the source line behind every address of the last build. */
+            [[nodiscard]]
+            bool WriteSymbols(const std::string &path, const std::string_view source_name) const;
     };
 
     static_assert(Assembler::SizeForInstruction(".byte 0xCC") == 1);
 
     static_assert(Assembler::ToNumber<std::uint8_t>("0xCC") == 0xCC);
+    static_assert(Assembler::ToNumber<std::uint8_t>("0b1010") == 0b1010);
+    static_assert(Assembler::ToNumber<std::uint8_t>("0o17")   == 017);
+    static_assert(Assembler::ToNumber<std::uint8_t>("255")    == 255);
+    static_assert(Assembler::ToNumber<std::uint8_t>("256")    == std::nullopt);
+    static_assert(Assembler::ToNumber<std::uint8_t>("0b102")  == std::nullopt);
+    static_assert(Assembler::ToNumber<std::uint16_t>("0xFFFF") == 0xFFFF);
+    static_assert(Assembler::ToNumber<std::uint64_t>("0xFFFFFFFFFFFFFFFF") == std::numeric_limits<std::uint64_t>::max());
 
     static_assert(Assembler::RegisterNibble("F")  == 0xF);
     static_assert(Assembler::RegisterNibble("f")  == std::nullopt);
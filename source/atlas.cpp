@@ -0,0 +1,169 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "atlas.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    bool InstanceGroup::Load(const std::string &path, const std::size_t count) {
+        this->instances.clear();
+        this->instances.reserve(count);
+
+        for ([[maybe_unused]] const auto i : std::views::iota(std::size_t{0}, count)) {
+            auto &ch8 = this->instances.emplace_back(std::make_unique<Chip8>());
+
+            if (!ch8->LoadProgram(path)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void InstanceGroup::Start() {
+        const auto worker_count = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), this->instances.size());
+
+        for (const auto worker : std::views::iota(std::size_t{0}, worker_count)) {
+            this->workers.emplace_back([this, worker, worker_count](std::stop_token token) {
+                /* Each worker owns every nth instance. */
+                std::vector<Chip8 *> owned;
+                for (std::size_t i = worker; i < this->instances.size(); i += worker_count) {
+                    owned.push_back(this->instances[i].get());
+                }
+
+                auto next_frame = std::chrono::steady_clock::now();
+
+                while (!token.stop_requested() && !owned.empty()) {
+                    /* Instances which stop running are dropped, leaving their last frame up. */
+                    std::erase_if(owned, [](Chip8 *ch8) {
+                        if (!ch8->RunFrame()) {
+                            ch8->PrintFault();
+                            return true;
+                        }
+
+                        ch8->display.Publish();
+
+                        return false;
+                    });
+
+                    next_frame = std::max(next_frame + Chip8::PresentInterval, std::chrono::steady_clock::now());
+
+                    std::this_thread::sleep_until(next_frame);
+                }
+            });
+        }
+    }
+
+    void InstanceGroup::Stop() {
+        for (auto &worker : this->workers) {
+            worker.request_stop();
+        }
+
+        this->workers.clear();
+    }
+
+    AtlasView::AtlasView(const std::size_t count) : count(count) {
+        this->columns = static_cast<unsigned>(std::ceil(std::sqrt(static_cast<double>(count))));
+        this->rows    = static_cast<unsigned>((count + this->columns - 1) / this->columns);
+
+        this->pixels.resize(this->Width() * this->Height() * 4);
+
+        /* Fill everything with the gap shade, tiles will paint over their part. */
+        for (auto it = this->pixels.begin(); it != this->pixels.end(); it += 4) {
+            it[0] = GapShade;
+            it[1] = GapShade;
+            it[2] = GapShade;
+            it[3] = 0xFF;
+        }
+
+        /* Start with every bit flipped so every tile is drawn the first time. */
+        Display::Buffer never_drawn;
+        std::ranges::fill(never_drawn, Display::FullRow);
+
+        this->drawn.assign(count, never_drawn);
+
+        this->texture.create(this->Width(), this->Height());
+    }
+
+    void AtlasView::DrawTile(const std::size_t index, const Display::Buffer &buffer) {
+        if (this->drawn[index] == buffer) {
+            return;
+        }
+
+        this->drawn[index] = buffer;
+
+        const auto tile_x = (index % this->columns) * (TileWidth  + TileGap);
+        const auto tile_y = (index / this->columns) * (TileHeight + TileGap);
+
+        for (const auto y : std::views::iota(Display::Coord{0}, Display::DisplayHeight)) {
+            auto pixel = this->pixels.data() + ((tile_y + y) * this->Width() + tile_x) * 4;
+
+            for (const auto x : std::views::iota(Display::Coord{0}, Display::DisplayWidth)) {
+                const auto value = ((buffer[y] & Display::XBit(x)) != 0) ? sf::Uint8{0xFF} : sf::Uint8{0x00};
+
+                pixel[0] = value;
+                pixel[1] = value;
+                pixel[2] = value;
+                pixel[3] = 0xFF;
+
+                pixel += 4;
+            }
+        }
+    }
+
+    bool AtlasView::Render(sf::RenderWindow &window) {
+        this->texture.update(this->pixels.data());
+
+        auto sprite = sf::Sprite(this->texture);
+        sprite.setScale(this->Scale(), this->Scale());
+
+        window.clear();
+        window.draw(sprite);
+        window.display();
+
+        return true;
+    }
+
+    void AtlasView::Loop(InstanceGroup &group) {
+        auto window = this->OpenWindow();
+
+        group.Start();
+
+        auto next_frame = std::chrono::steady_clock::now();
+
+        while (window.isOpen()) {
+
+            const auto should_break = [&]() {
+                sf::Event event;
+                while (window.pollEvent(event)) {
+                    if (event.type == sf::Event::Closed) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }();
+
+            if (should_break) {
+                break;
+            }
+
+            for (const auto &&[index, ch8] : util::enumerate(group.instances)) {
+                this->DrawTile(index, ch8->display.published.Latest());
+            }
+
+            if (!this->Render(window)) {
+                break;
+            }
+
+            next_frame = std::max(next_frame + Chip8::PresentInterval, std::chrono::steady_clock::now());
+
+            std::this_thread::sleep_until(next_frame);
+        }
+
+        group.Stop();
+
+        window.close();
+    }
+
+}
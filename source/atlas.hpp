@@ -0,0 +1,85 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    /* Runs many machines at once, spread over a few worker threads. */
+    class InstanceGroup {
+        NON_COPYABLE(InstanceGroup);
+        NON_MOVEABLE(InstanceGroup);
+
+        public:
+            std::vector<std::unique_ptr<Chip8>> instances;
+            std::vector<std::jthread> workers;
+
+            ALWAYS_INLINE InstanceGroup() = default;
+
+            [[nodiscard]]
+            bool Load(const std::string &path, const std::size_t count);
+
+            void Start();
+            void Stop();
+
+            ALWAYS_INLINE ~InstanceGroup() {
+                this->Stop();
+            }
+    };
+
+    /* Packs every instance's display into one texture, uploaded and drawn once per frame. */
+    class AtlasView {
+        NON_COPYABLE(AtlasView);
+        NON_MOVEABLE(AtlasView);
+
+        public:
+            static constexpr unsigned TileWidth  = Display::DisplayWidth;
+            static constexpr unsigned TileHeight = Display::DisplayHeight;
+
+            /* Dark pixels between tiles so neighbouring screens don't run together. */
+            static constexpr unsigned TileGap = 1;
+
+            static constexpr unsigned MaxWindowWidth = 1280;
+
+            static constexpr sf::Uint8 GapShade = 0x40;
+
+            std::size_t count;
+            unsigned columns, rows;
+
+            std::vector<sf::Uint8> pixels;
+
+            /* What each tile was last drawn with, so unchanged tiles can be skipped. */
+            std::vector<Display::Buffer> drawn;
+
+            sf::Texture texture;
+
+            explicit AtlasView(const std::size_t count);
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr unsigned Width() const {
+                return this->columns * (TileWidth + TileGap) - TileGap;
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr unsigned Height() const {
+                return this->rows * (TileHeight + TileGap) - TileGap;
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr unsigned Scale() const {
+                return std::max(1u, MaxWindowWidth / this->Width());
+            }
+
+            ALWAYS_INLINE sf::RenderWindow OpenWindow() const {
+                return sf::RenderWindow(sf::VideoMode(this->Width() * this->Scale(), this->Height() * this->Scale()), "tshipate");
+            }
+
+            void DrawTile(const std::size_t index, const Display::Buffer &buffer);
+
+            bool Render(sf::RenderWindow &window);
+
+            void Loop(InstanceGroup &group);
+    };
+
+}
@@ -0,0 +1,102 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "batch.hpp"
+
+namespace tsh {
+
+    bool BatchRunner::AddList(const std::string &path) {
+        const auto data = util::ReadFromFile(path);
+        if (!data.has_value()) {
+            return false;
+        }
+
+        const auto text = std::string_view(reinterpret_cast<const char *>(data->data()), data->size());
+
+        for (const auto line_range : std::views::split(text, '\n')) {
+            auto line = std::string_view(line_range.begin(), line_range.end());
+
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+                line.remove_suffix(1);
+            }
+
+            if (line.empty() || line.front() == '#') {
+                continue;
+            }
+
+            this->jobs.push_back(Job{std::string(line), {}});
+        }
+
+        return true;
+    }
+
+    void BatchRunner::AddArchive(const RomArchive &archive) {
+        for (const auto &entry : archive) {
+            this->jobs.push_back(Job{std::string(entry.name), entry.data});
+        }
+    }
+
+    void BatchRunner::Run(util::ThreadPool &pool) {
+        this->results.assign(this->jobs.size(), Result{});
+
+        /* Each task only touches its own result. */
+        for (const auto i : std::views::iota(std::size_t{0}, this->jobs.size())) {
+            pool.Submit([this, i]() {
+                this->results[i] = this->RunJob(this->jobs[i]);
+            });
+        }
+
+        pool.Wait();
+    }
+
+    BatchRunner::Result BatchRunner::RunJob(const Job &job) const {
+        Result result;
+
+        auto ch8 = std::make_unique<Chip8>();
+        ch8->rng.Seed(this->seed);
+
+        result.loaded = job.data.has_value() ? ch8->LoadProgram(*job.data) : ch8->LoadProgram(job.name);
+        if (!result.loaded) {
+            return result;
+        }
+
+        while (result.frames < this->frame_budget && ch8->cycles < this->cycle_budget) {
+            if (!ch8->RunFrame()) {
+                break;
+            }
+
+            result.frames++;
+        }
+
+        result.hash   = ch8->display.Hash();
+        result.cycles = ch8->cycles;
+
+        result.fault         = ch8->fault;
+        result.fault_address = ch8->fault_address;
+        result.fault_opcode  = ch8->fault_opcode;
+
+        return result;
+    }
+
+    void BatchRunner::Print() const {
+        for (const auto i : std::views::iota(std::size_t{0}, this->results.size())) {
+            const auto &job    = this->jobs[i];
+            const auto &result = this->results[i];
+
+            if (!result.loaded) {
+                fmt::print("{:16} {:>12} {:>8} {:<32} {}\n", "-", "-", "-", "failed to load", job.name);
+                continue;
+            }
+
+            const auto status = [&]() -> std::string {
+                if (result.fault == Chip8::FaultKind::None) {
+                    return "ok";
+                }
+
+                return fmt::format("{} {:04X} at {:04X}", Chip8::FaultNames[result.fault], result.fault_opcode, result.fault_address);
+            }();
+
+            fmt::print("{:016x} {:>12} {:>8} {:<32} {}\n", result.hash, result.cycles, result.frames, status, job.name);
+        }
+    }
+
+}
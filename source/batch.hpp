@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+#include "archive.hpp"
+
+namespace tsh {
+
+    /*
+        Runs a whole corpus of roms headless, spread over a thread
+        pool, and reports how each of them ended up.
+    */
+    class BatchRunner {
+        NON_COPYABLE(BatchRunner);
+        NON_MOVEABLE(BatchRunner);
+
+        public:
+            struct Job {
+                std::string name;
+
+                /* Without data, the name is a path to load from. */
+                std::optional<std::span<const std::byte>> data;
+            };
+
+            struct Result {
+                bool loaded = false;
+
+                /* Hash of the display once the rom stopped. */
+                std::uint64_t hash = 0;
+
+                std::uint64_t cycles = 0;
+                std::size_t frames = 0;
+
+                Chip8::FaultKind fault = Chip8::FaultKind::None;
+                Address fault_address = 0;
+                RawOpcode fault_opcode = 0;
+            };
+
+            std::size_t frame_budget;
+
+            /* Checked between frames, so a rom may run up to a frame over. */
+            std::uint64_t cycle_budget;
+
+            /* Every rom starts from the same seed so results can be compared between runs. */
+            std::uint64_t seed;
+
+            std::vector<Job> jobs;
+            std::vector<Result> results;
+
+            ALWAYS_INLINE BatchRunner(const std::size_t frame_budget, const std::uint64_t cycle_budget, const std::uint64_t seed)
+                : frame_budget(frame_budget), cycle_budget(cycle_budget), seed(seed) { }
+
+            /* A text file with one rom path per line. Blank lines and lines starting with '#' are skipped. */
+            [[nodiscard]]
+            bool AddList(const std::string &path);
+
+            /* The archive must outlive the runner. */
+            void AddArchive(const RomArchive &archive);
+
+            void Run(util::ThreadPool &pool);
+
+            [[nodiscard]]
+            Result RunJob(const Job &job) const;
+
+            /* One line per rom, in the order they were added. */
+            void Print() const;
+    };
+
+}
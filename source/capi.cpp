@@ -0,0 +1,93 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+
+#include <tshipate/tshipate.h>
+
+struct tsh_machine {
+    tsh::Chip8 ch8;
+};
+
+static_assert(TSHIPATE_DISPLAY_WIDTH  == tsh::Display::DisplayWidth);
+static_assert(TSHIPATE_DISPLAY_HEIGHT == tsh::Display::DisplayHeight);
+
+static_assert(TSHIPATE_FAULT_NONE            == static_cast<int>(tsh::Chip8::FaultKind::None));
+static_assert(TSHIPATE_FAULT_STACK_OVERFLOW  == static_cast<int>(tsh::Chip8::FaultKind::StackOverflow));
+static_assert(TSHIPATE_FAULT_STACK_UNDERFLOW == static_cast<int>(tsh::Chip8::FaultKind::StackUnderflow));
+static_assert(TSHIPATE_FAULT_UNKNOWN_OPCODE  == static_cast<int>(tsh::Chip8::FaultKind::UnknownOpcode));
+
+/* The framebuffer is handed out as is. */
+static_assert(std::same_as<tsh::Display::RowType, std::uint64_t>);
+
+/* Nothing may unwind into C, so whatever can throw turns it into its failure value. */
+extern "C" {
+
+    tsh_machine *tsh_create(const std::uint8_t *rom, const std::size_t size, const std::uint64_t seed) noexcept {
+        try {
+            auto machine = std::make_unique<tsh_machine>();
+
+            if (!machine->ch8.LoadProgram(std::as_bytes(std::span(rom, size)))) {
+                return nullptr;
+            }
+
+            machine->ch8.rng.Seed(seed);
+
+            return machine.release();
+        } catch (...) {
+            return nullptr;
+        }
+    }
+
+    void tsh_destroy(tsh_machine *machine) noexcept {
+        delete machine;
+    }
+
+    void tsh_set_keys(tsh_machine *machine, const std::uint16_t pressed_keys) noexcept {
+        machine->ch8.keyboard.SetPressedKeys(pressed_keys);
+    }
+
+    std::size_t tsh_step(tsh_machine *machine, const std::size_t frames) noexcept {
+        std::size_t frame = 0;
+
+        try {
+            while (frame < frames && machine->ch8.RunFrame()) {
+                frame++;
+            }
+        } catch (...) { }
+
+        return frame;
+    }
+
+    const std::uint64_t *tsh_framebuffer(const tsh_machine *machine) noexcept {
+        return machine->ch8.display.buffer.data();
+    }
+
+    int tsh_fault(const tsh_machine *machine) noexcept {
+        return static_cast<int>(machine->ch8.fault);
+    }
+
+    std::uint64_t tsh_cycles(const tsh_machine *machine) noexcept {
+        return machine->ch8.cycles;
+    }
+
+    std::size_t tsh_state_size() noexcept {
+        return tsh::Chip8::StateSize;
+    }
+
+    int tsh_save_state(const tsh_machine *machine, std::uint8_t *out, const std::size_t size) noexcept {
+        try {
+            return machine->ch8.SaveState(std::as_writable_bytes(std::span(out, size))) ? 0 : -1;
+        } catch (...) {
+            return -1;
+        }
+    }
+
+    int tsh_load_state(tsh_machine *machine, const std::uint8_t *in, const std::size_t size) noexcept {
+        try {
+            return machine->ch8.LoadState(std::as_bytes(std::span(in, size))) ? 0 : -1;
+        } catch (...) {
+            return -1;
+        }
+    }
+
+}
@@ -0,0 +1,152 @@
+#include <unistd.h>
+
+#include "common.hpp"
+#include "util.hpp"
+#include "capture.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        /* Studio range, which is what Y4M consumers assume. */
+        constexpr std::uint8_t Y4MBlack = 16;
+        constexpr std::uint8_t Y4MWhite = 235;
+
+    }
+
+    FrameCapture::~FrameCapture() {
+        this->Close();
+    }
+
+    bool FrameCapture::Open(const std::string &path) {
+        if (path == "-") {
+            /* Frames get stdout to themselves. Anything else printed there goes to stderr from now on. */
+            std::fflush(stdout);
+
+            const auto fd = ::dup(STDOUT_FILENO);
+            if (fd < 0) {
+                return false;
+            }
+
+            if (::dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+                ::close(fd);
+                return false;
+            }
+
+            this->fp = ::fdopen(fd, "wb");
+            if (this->fp == nullptr) {
+                ::close(fd);
+                return false;
+            }
+        } else {
+            this->fp = std::fopen(path.c_str(), "wb");
+            if (this->fp == nullptr) {
+                return false;
+            }
+        }
+
+        this->WriteHeader();
+
+        this->writer = std::jthread([this](std::stop_token token) {
+            this->WriterLoop(token);
+        });
+
+        return true;
+    }
+
+    void FrameCapture::Close() {
+        if (this->fp == nullptr) {
+            return;
+        }
+
+        if (this->writer.joinable()) {
+            this->writer.request_stop();
+
+            this->signal.fetch_add(1, std::memory_order_release);
+            this->signal.notify_one();
+
+            this->writer.join();
+        }
+
+        std::fclose(this->fp);
+
+        this->fp = nullptr;
+    }
+
+    void FrameCapture::Submit(const Frame &frame) {
+        if (!this->ring.TryPush(frame)) {
+            this->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        this->signal.fetch_add(1, std::memory_order_release);
+        this->signal.notify_one();
+    }
+
+    void FrameCapture::WriteHeader() {
+        if (this->format == Format::Y4M) {
+            fmt::print(this->fp, "YUV4MPEG2 W{} H{} F60:1 Ip A1:1 Cmono\n", Display::DisplayWidth, Display::DisplayHeight);
+        }
+    }
+
+    void FrameCapture::WriteFrame(const Frame &frame) {
+        /* Largest encoding is one RGB triple per pixel. */
+        std::array<std::uint8_t, PixelCount * 3> encoded;
+        auto out = encoded.begin();
+
+        const auto [off, on, channels] = [&]() {
+            if (this->format == Format::Y4M) {
+                return std::tuple{Y4MBlack, Y4MWhite, std::size_t{1}};
+            }
+
+            if (this->format == Format::PPM) {
+                return std::tuple{std::uint8_t{0x00}, std::uint8_t{0xFF}, std::size_t{3}};
+            }
+
+            return std::tuple{std::uint8_t{0x00}, std::uint8_t{0xFF}, std::size_t{1}};
+        }();
+
+        for (const auto &row : frame) {
+            for (const auto x : std::views::iota(Display::Coord{0}, Display::DisplayWidth)) {
+                const auto value = ((row & Display::XBit(x)) != 0) ? on : off;
+
+                out = std::fill_n(out, channels, value);
+            }
+        }
+
+        if (this->format == Format::Y4M) {
+            std::fputs("FRAME\n", this->fp);
+        } else if (this->format == Format::PPM) {
+            fmt::print(this->fp, "P6\n{} {}\n255\n", Display::DisplayWidth, Display::DisplayHeight);
+        }
+
+        std::fwrite(encoded.data(), 1, out - encoded.begin(), this->fp);
+
+        this->written_frames++;
+    }
+
+    void FrameCapture::WriterLoop(std::stop_token token) {
+        Frame frame;
+
+        while (true) {
+            const auto seen = this->signal.load(std::memory_order_acquire);
+
+            while (this->ring.TryPop(frame)) {
+                this->WriteFrame(frame);
+            }
+
+            /* Only stop once everything submitted before the stop has been written. */
+            if (token.stop_requested()) {
+                while (this->ring.TryPop(frame)) {
+                    this->WriteFrame(frame);
+                }
+
+                break;
+            }
+
+            this->signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    class FrameCapture {
+        NON_COPYABLE(FrameCapture);
+        NON_MOVEABLE(FrameCapture);
+
+        public:
+            enum class Format {
+                Raw,
+                Y4M,
+                PPM,
+            };
+
+            static constexpr auto FormatNames = util::Map(
+                std::optional<Format>{},
+
+                std::pair{std::string_view("raw"), std::optional{Format::Raw}},
+                std::pair{std::string_view("y4m"), std::optional{Format::Y4M}},
+                std::pair{std::string_view("ppm"), std::optional{Format::PPM}}
+            );
+
+            /* Roughly a second of frames before we start dropping. */
+            static constexpr std::size_t RingCapacity = 64;
+
+            static constexpr std::size_t PixelCount = Display::DisplayWidth * Display::DisplayHeight;
+
+            using Frame = Display::Buffer;
+
+            Format format;
+            std::FILE *fp = nullptr;
+
+            util::SpscRing<Frame, RingCapacity> ring;
+
+            /* Bumped by the emulation thread on every submission so the writer can wait on it. */
+            std::atomic<std::uint32_t> signal = 0;
+
+            std::atomic<std::size_t> dropped_frames = 0;
+            std::size_t written_frames = 0;
+
+            std::jthread writer;
+
+            ALWAYS_INLINE FrameCapture(const Format format) : format(format) { }
+
+            ~FrameCapture();
+
+            [[nodiscard]]
+            bool Open(const std::string &path);
+
+            void Close();
+
+            /* Never blocks. Frames that don't fit in the ring are counted and dropped. */
+            void Submit(const Frame &frame);
+
+            void WriteHeader();
+            void WriteFrame(const Frame &frame);
+            void WriterLoop(std::stop_token token);
+    };
+
+}
@@ -2,6 +2,10 @@
 #include "util.hpp"
 #include "chip8.hpp"
 #include "instruction.hpp"
+#include "capture.hpp"
+#include "phosphor.hpp"
+#include "movie.hpp"
+#include "rewind.hpp"
 
 namespace tsh {
 
@@ -25,18 +29,193 @@ namespace tsh {
         return true;
     }
 
+    namespace {
+
+        /* Names for the host keys a profile may map to. */
+        constexpr std::optional<sf::Keyboard::Key> HostKeyFromName(const std::string_view name) {
+            const auto offset_key = [](const sf::Keyboard::Key base, const char offset) {
+                return static_cast<sf::Keyboard::Key>(base + offset);
+            };
+
+            if (name.size() == 1 && name[0] >= 'A' && name[0] <= 'Z') {
+                return offset_key(sf::Keyboard::A, name[0] - 'A');
+            }
+
+            if (name.size() == 4 && name.starts_with("Num") && name[3] >= '0' && name[3] <= '9') {
+                return offset_key(sf::Keyboard::Num0, name[3] - '0');
+            }
+
+            if (name.size() == 7 && name.starts_with("Numpad") && name[6] >= '0' && name[6] <= '9') {
+                return offset_key(sf::Keyboard::Numpad0, name[6] - '0');
+            }
+
+            return {};
+        }
+
+        static_assert(HostKeyFromName("Q")       == sf::Keyboard::Q);
+        static_assert(HostKeyFromName("Num4")    == sf::Keyboard::Num4);
+        static_assert(HostKeyFromName("Numpad9") == sf::Keyboard::Numpad9);
+        static_assert(HostKeyFromName("q")       == std::nullopt);
+
+    }
+
+    bool Keyboard::LoadProfile(const std::string &path) {
+        const auto fp = std::fopen(path.c_str(), "r");
+        if (fp == nullptr) {
+            return false;
+        }
+
+        ON_SCOPE_EXIT { std::fclose(fp); };
+
+        char key_name[2], host_name[16];
+        while (true) {
+            const auto scanned = std::fscanf(fp, "%1s %15s", key_name, host_name);
+            if (scanned == EOF) {
+                break;
+            }
+
+            if (scanned != 2) {
+                return false;
+            }
+
+            std::uint8_t key;
+            if (std::from_chars(key_name, key_name + 1, key, 16).ec != std::errc()) {
+                return false;
+            }
+
+            const auto host_key = HostKeyFromName(host_name);
+            if (!host_key.has_value()) {
+                return false;
+            }
+
+            if (!this->mapping.Set(static_cast<Key>(key), *host_key)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     bool Keyboard::HandleEvent(const sf::Event &event) {
-        if (event.type == sf::Event::KeyPressed) {
-            const auto key = KeyToInternal.KeyForValue(event.key.code);
+        if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) {
+            const auto key = this->mapping.KeyForValue(event.key.code);
 
             if (key.has_value()) {
-                this->current_key = *key;
+                if (event.type == sf::Event::KeyPressed) {
+                    this->PressKey(*key);
+                } else {
+                    this->ReleaseKey(*key);
+                }
             }
         }
 
+        /* We won't hear about keys released while unfocused. */
+        if (event.type == sf::Event::LostFocus) {
+            this->pressed_keys = 0;
+        }
+
         return true;
     }
 
+    SharedMemory::SharedMemory() : block(std::make_shared<Block>()) { }
+
+    SharedMemory::SharedMemory(const SharedMemory &other) : block(other.block) {
+        this->block->shared.store(true, std::memory_order_release);
+    }
+
+    SharedMemory &SharedMemory::operator =(const SharedMemory &other) {
+        this->block = other.block;
+        this->block->shared.store(true, std::memory_order_release);
+
+        return *this;
+    }
+
+    void SharedMemory::ReadBytes(const std::size_t address, const std::span<std::byte> out) const {
+        std::size_t done = 0;
+        while (done < out.size()) {
+            const auto wrapped = Wrap(address + done);
+            const auto chunk   = std::min(Size - wrapped, out.size() - done);
+
+            std::memcpy(out.data() + done, this->block->bytes.data() + wrapped, chunk);
+
+            done += chunk;
+        }
+    }
+
+    void SharedMemory::WriteBytes(const std::size_t address, const std::span<const std::byte> in) {
+        auto &bytes = this->Writable(in.size() < Size);
+
+        std::size_t done = 0;
+        while (done < in.size()) {
+            const auto wrapped = Wrap(address + done);
+            const auto chunk   = std::min(Size - wrapped, in.size() - done);
+
+            std::memcpy(bytes.data() + wrapped, in.data() + done, chunk);
+
+            done += chunk;
+        }
+    }
+
+    void SharedMemory::Unshare(const bool keep_contents) {
+        auto own = std::make_shared<Block>();
+        if (keep_contents) {
+            own->bytes = this->block->bytes;
+        }
+
+        this->block = std::move(own);
+    }
+
+    const SharedMemory &Chip8::BootMemory() {
+        static const auto boot = []() {
+            SharedMemory memory;
+
+            /*
+                The compiler didn't optimize copying each digit separately as
+                well as I would've hoped, so copy all of them in one fell swoop.
+            */
+            const auto raw_digits = reinterpret_cast<const std::byte *>(Digits.data());
+            memory.WriteBytes(DigitSpace.start, std::span(raw_digits, sizeof(Digits)));
+
+            return memory;
+        }();
+
+        return boot;
+    }
+
+    std::unique_ptr<Chip8> Chip8::Fork() const {
+        auto child = std::make_unique<Chip8>();
+
+        child->memory = this->memory;
+
+        child->display.buffer = this->display.buffer;
+
+        for (const auto i : std::views::iota(std::size_t{0}, this->V.size())) {
+            child->V[i].Set(this->V[i].Get());
+        }
+
+        child->I.Set(this->I.Get());
+        child->PC.Set(this->PC.Get());
+
+        child->DT.Set(this->DT.Get());
+        child->ST.Set(this->ST.Get());
+
+        child->stack = this->stack;
+
+        child->keyboard.mapping      = this->keyboard.mapping;
+        child->keyboard.pressed_keys = this->keyboard.pressed_keys;
+        child->keyboard.current_key  = this->keyboard.current_key;
+
+        child->rng.state = this->rng.state;
+
+        child->fault         = this->fault;
+        child->fault_address = this->fault_address;
+        child->fault_opcode  = this->fault_opcode;
+
+        child->cycles = this->cycles;
+
+        return child;
+    }
+
     bool Chip8::PropagateEvent(const sf::Event &event) {
         /*
             Wish I could use reflection to loop over attributes
@@ -53,47 +232,200 @@ namespace tsh {
         return true;
     }
 
+    void Chip8::PrintFault() const {
+        if (this->fault == FaultKind::UnknownOpcode) {
+            fmt::print("Unhandled opcode: {:04X}\n", this->fault_opcode);
+
+            return;
+        }
+
+        fmt::print("Fault at {:04X}: {}\n", this->fault_address, FaultNames[this->fault]);
+    }
+
     bool Chip8::Tick() {
         const auto op = Opcode(this->ReadRawOpcode());
 
         const auto advance = Instructions::Execute(*this, op);
         if (!advance.has_value()) {
-            fmt::print("Unhandled opcode: {:04X}\n", op.Get());
+            this->Fault(FaultKind::UnknownOpcode);
+        }
+
+        if (this->fault != FaultKind::None) {
+            this->fault_address = this->PC.Get();
+            this->fault_opcode  = op.Get();
 
             return false;
         }
 
-        this->PC.Increment(*advance * sizeof(Opcode));
+        this->cycles++;
 
-        std::this_thread::sleep_for(InstructionDuration);
+        this->PC.Increment(*advance * sizeof(Opcode));
 
         return true;
     }
 
-    void Chip8::Loop() {
-        auto window = this->display.OpenWindow();
+    bool Chip8::SaveState(const std::span<std::byte> out) const {
+        auto writer = util::ByteWriter(out);
 
-        this->DT.StartThread([this](std::stop_token token) {
-            while (!token.stop_requested()) {
-                if (this->DT.Get() != 0) {
-                    this->DT.Decrement(1);
-                }
+        writer.Write(StateMagic);
+        writer.Write(StateVersion);
+        writer.Write(std::uint16_t{0});
+
+        writer.WriteBytes(this->memory.block->bytes);
+
+        for (const auto &reg : this->V) {
+            writer.Write(reg.Get());
+        }
+
+        writer.Write(this->I.Get());
+        writer.Write(this->PC.Get());
+
+        writer.Write(this->DT.Get());
+        writer.Write(this->ST.Get());
 
-                std::this_thread::sleep_for(FrameDuration);
+        /* The whole stack is written so the state is always the same size. */
+        writer.Write(static_cast<std::uint8_t>(this->stack.size()));
+        for (const auto &address : this->stack.entries) {
+            writer.Write(address);
+        }
+
+        writer.Write(this->rng.state);
+
+        for (const auto &row : this->display.buffer) {
+            writer.Write(row);
+        }
+
+        writer.Write(this->keyboard.pressed_keys);
+        writer.Write(static_cast<std::uint8_t>(this->keyboard.current_key));
+
+        return writer.Ok() && writer.offset == StateSize;
+    }
+
+    bool Chip8::LoadState(const std::span<const std::byte> in) {
+        if (in.size() != StateSize) {
+            return false;
+        }
+
+        auto reader = util::ByteReader(in);
+
+        if (reader.Read<std::uint32_t>() != StateMagic || reader.Read<std::uint16_t>() != StateVersion) {
+            return false;
+        }
+
+        /* Padding. */
+        reader.Skip(sizeof(std::uint16_t));
+
+        /* Everything which could leave the machine somewhere it can't be is checked before any of it is touched. */
+        auto check = reader;
+
+        check.Skip(TotalSpace.Size() + this->V.size() * sizeof(std::uint8_t));
+
+        const auto in_memory = [](const Address address) {
+            return address < TotalSpace.end;
+        };
+
+        const auto I  = check.Read<Address>();
+        const auto PC = check.Read<Address>();
+        if (!in_memory(I) || !in_memory(PC)) {
+            return false;
+        }
+
+        check.Skip(2 * sizeof(std::uint8_t));
+
+        const auto depth = check.Read<std::uint8_t>();
+        if (depth > StackDepth) {
+            return false;
+        }
+
+        for (const auto i : std::views::iota(std::size_t{0}, StackDepth)) {
+            if (!in_memory(check.Read<Address>()) && i < depth) {
+                return false;
             }
-        });
+        }
 
-        this->ST.StartThread([this](std::stop_token token) {
-            while (!token.stop_requested()) {
-                if (this->ST.Get() != 0) {
-                    this->speaker.PlaySound();
+        check.Skip(sizeof(std::uint64_t) + Display::DisplayHeight * sizeof(Display::RowType) + sizeof(Keyboard::KeyMask));
 
-                    this->ST.Decrement(1);
-                }
+        if (check.Read<std::uint8_t>() > static_cast<std::uint8_t>(Key::Invalid) || !check.Ok()) {
+            return false;
+        }
+
+        reader.ReadBytes(this->memory.Writable(false));
+
+        for (auto &reg : this->V) {
+            reg.Set(reader.Read<std::uint8_t>());
+        }
+
+        this->I.Set(reader.Read<Address>());
+        this->PC.Set(reader.Read<Address>());
+
+        this->DT.Set(reader.Read<std::uint8_t>());
+        this->ST.Set(reader.Read<std::uint8_t>());
 
-                std::this_thread::sleep_for(FrameDuration);
+        this->stack.depth = reader.Read<std::uint8_t>();
+        for (auto &address : this->stack.entries) {
+            address = reader.Read<Address>();
+        }
+
+        this->rng.Seed(reader.Read<std::uint64_t>());
+
+        for (auto &row : this->display.buffer) {
+            row = reader.Read<Display::RowType>();
+        }
+
+        this->keyboard.pressed_keys = reader.Read<Keyboard::KeyMask>();
+        this->keyboard.current_key  = static_cast<Key>(reader.Read<std::uint8_t>());
+
+        this->fault = FaultKind::None;
+
+        return reader.Ok();
+    }
+
+    void Chip8::StepTimers() {
+        this->DT.Step();
+
+        if (this->ST.Step()) {
+            this->speaker.PlaySound();
+        }
+    }
+
+    bool Chip8::RunFrame() {
+        if (this->replay != nullptr) {
+            this->replay->Play(this->keyboard);
+        }
+
+        if (this->recording != nullptr) {
+            this->recording->Record(this->keyboard);
+        }
+
+        this->frame_yielded = false;
+
+        for (std::size_t i = 0; i < InstructionsPerFrame && !this->frame_yielded; i++) {
+            if (!this->Tick()) {
+                return false;
             }
-        });
+        }
+
+        this->StepTimers();
+
+        return true;
+    }
+
+    void Chip8::PresentFrame() {
+        if (this->capture != nullptr) {
+            this->capture->Submit(this->display.buffer);
+        }
+
+        if (this->frame_hashes != nullptr) {
+            this->frame_hashes->push_back(this->display.Hash());
+        }
+    }
+
+    void Chip8::Loop() {
+        auto window = this->display.OpenWindow();
+
+        auto next_frame = std::chrono::steady_clock::now();
+
+        bool rewinding = false;
 
         while (window.isOpen()) {
 
@@ -105,6 +437,10 @@ namespace tsh {
                         return true;
                     }
 
+                    if ((event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) && event.key.code == RewindKey) {
+                        rewinding = (event.type == sf::Event::KeyPressed);
+                    }
+
                     if (!this->PropagateEvent(event)) {
                         return true;
                     }
@@ -117,19 +453,55 @@ namespace tsh {
                 break;
             }
 
-            if (!this->Tick()) {
-                break;
+            if (this->rewind != nullptr && rewinding) {
+                /* Once out of snapshots, hold on the oldest one. */
+                this->rewind->StepBack(*this);
+            } else {
+                if (!this->RunFrame()) {
+                    this->PrintFault();
+                    break;
+                }
+
+                if (this->rewind != nullptr) {
+                    this->rewind->OnFrame(*this);
+                }
             }
 
-            if (!this->display.Render(window)) {
+            const auto rendered = [&]() {
+                if (this->phosphor != nullptr) {
+                    this->phosphor->Update(this->display.buffer);
+
+                    return this->phosphor->Render(window);
+                }
+
+                return this->display.Render(window);
+            }();
+
+            if (!rendered) {
                 break;
             }
-        }
 
-        this->DT.RequestStop();
-        this->DT.Join();
+            this->PresentFrame();
+
+            /* Don't try to catch up if we've fallen behind, just carry on from now. */
+            next_frame = std::max(next_frame + PresentInterval, std::chrono::steady_clock::now());
+
+            std::this_thread::sleep_until(next_frame);
+        }
 
         window.close();
     }
 
+    bool Chip8::RunHeadless(const std::size_t frames) {
+        for ([[maybe_unused]] const auto frame : std::views::iota(std::size_t{0}, frames)) {
+            if (!this->RunFrame()) {
+                return false;
+            }
+
+            this->PresentFrame();
+        }
+
+        return true;
+    }
+
 }
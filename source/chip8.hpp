@@ -7,6 +7,21 @@
 
 namespace tsh {
 
+    /* Forward declare. */
+    class FrameCapture;
+
+    /* Forward declare. */
+    class Phosphor;
+
+    /* Forward declare. */
+    class InputMovie;
+
+    /* Forward declare. */
+    class MoviePlayer;
+
+    /* Forward declare. */
+    class Rewind;
+
     class AddressSpace {
         public:
             Address start, end;
@@ -75,40 +90,36 @@ namespace tsh {
         NON_MOVEABLE(Timer);
 
         public:
-            std::atomic<Internal> value = {};
-
-            std::jthread thread;
+            Internal value = {};
 
-            ALWAYS_INLINE Timer() = default;
+            ALWAYS_INLINE constexpr Timer() = default;
 
             [[nodiscard]]
-            ALWAYS_INLINE Internal Get() {
-                return this->value.load();
+            ALWAYS_INLINE constexpr Internal Get() const {
+                return this->value;
             }
 
-            ALWAYS_INLINE void Set(const Internal value) {
-                this->value.store(value);
+            ALWAYS_INLINE constexpr void Set(const Internal value) {
+                this->value = value;
             }
 
-            ALWAYS_INLINE void Increment(const Internal delta) {
+            ALWAYS_INLINE constexpr void Increment(const Internal delta) {
                 this->value += delta;
             }
 
-            ALWAYS_INLINE void Decrement(const Internal delta) {
+            ALWAYS_INLINE constexpr void Decrement(const Internal delta) {
                 this->value -= delta;
             }
 
-            template<typename... Args>
-            ALWAYS_INLINE void StartThread(Args &&... args) {
-                this->thread = std::jthread(std::forward<Args>(args)...);
-            }
+            /* Counts down once per frame, stopping at zero. Returns whether the timer was active. */
+            ALWAYS_INLINE constexpr bool Step() {
+                if (this->value == 0) {
+                    return false;
+                }
 
-            ALWAYS_INLINE bool RequestStop() {
-                return this->thread.request_stop();
-            }
+                this->Decrement(1);
 
-            ALWAYS_INLINE void Join() {
-                this->thread.join();
+                return true;
             }
     };
 
@@ -138,8 +149,13 @@ namespace tsh {
                 return (RowType{1} << (DisplayWidth - x - 1));
             }
 
+            using Buffer = std::array<RowType, DisplayHeight>;
+
             /* Bitmap representing on/off pixels. */
-            std::array<RowType, DisplayHeight> buffer = {};
+            Buffer buffer = {};
+
+            /* Snapshots of the bitmap which other threads can read. */
+            util::TripleBuffer<Buffer> published;
 
             ALWAYS_INLINE constexpr Display() = default;
 
@@ -164,6 +180,15 @@ namespace tsh {
                 this->buffer[y] ^= XBit(x);
             }
 
+            ALWAYS_INLINE void Publish() {
+                this->published.Publish(this->buffer);
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE std::uint64_t Hash() const {
+                return util::Hash64(std::as_bytes(std::span(this->buffer)));
+            }
+
             constexpr bool DrawSprite(const Coord x, Coord y, const std::span<const std::byte> data) {
                 bool collide = false;
 
@@ -252,15 +277,70 @@ namespace tsh {
                 std::pair{Key::F,     sf::Keyboard::Num6}
             );
 
+            static constexpr std::size_t KeyCount = static_cast<std::size_t>(Key::Invalid);
+
+            using KeyMapping = util::DenseMap<Key, sf::Keyboard::Key, KeyCount, sf::Keyboard::KeyCount>;
+
+            static constexpr auto DefaultMapping = KeyMapping(KeyToInternal);
+
+            static_assert(DefaultMapping[Key::A] == sf::Keyboard::Num1);
+            static_assert(DefaultMapping[Key::Invalid] == sf::Keyboard::Unknown);
+            static_assert(DefaultMapping.KeyForValue(sf::Keyboard::Numpad7) == Key::One);
+            static_assert(DefaultMapping.KeyForValue(sf::Keyboard::Unknown) == std::nullopt);
+
+            using KeyMask = std::uint16_t;
+
+            static_assert(BITSIZEOF(KeyMask) == KeyCount);
+
+            KeyMapping mapping = DefaultMapping;
+
+            /* One bit per key, kept up to date by events or by whatever is injecting input. */
+            KeyMask pressed_keys = 0;
+
             Key current_key = Key::Invalid;
 
             ALWAYS_INLINE constexpr Keyboard() = default;
 
             [[nodiscard]]
-            ALWAYS_INLINE bool IsKeyPressed(const Key key) const {
-                return sf::Keyboard::isKeyPressed(KeyToInternal[key]);
+            static constexpr KeyMask KeyBit(const Key key) {
+                return static_cast<KeyMask>(KeyMask{1} << static_cast<std::uint8_t>(key));
             }
 
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr bool IsKeyPressed(const Key key) const {
+                if (key >= Key::Invalid) {
+                    return false;
+                }
+
+                return (this->pressed_keys & KeyBit(key)) != 0;
+            }
+
+            ALWAYS_INLINE constexpr void PressKey(const Key key) {
+                this->pressed_keys |= KeyBit(key);
+                this->current_key   = key;
+            }
+
+            ALWAYS_INLINE constexpr void ReleaseKey(const Key key) {
+                this->pressed_keys &= ~KeyBit(key);
+            }
+
+            /* For input which doesn't come from events, e.g. when headless. */
+            constexpr void SetPressedKeys(const KeyMask mask) {
+                const KeyMask newly_pressed = mask & ~this->pressed_keys;
+                if (newly_pressed != 0) {
+                    this->current_key = static_cast<Key>(std::countr_zero(newly_pressed));
+                }
+
+                this->pressed_keys = mask;
+            }
+
+            /*
+                Loads a remap profile, one "<hex key> <host key>" pair per line,
+                e.g. "A Q". Keys not mentioned keep their current mapping.
+            */
+            [[nodiscard]]
+            bool LoadProfile(const std::string &path);
+
             [[nodiscard]]
             ALWAYS_INLINE constexpr Key CurrentKey() {
                 ON_SCOPE_EXIT { this->current_key = Key::Invalid; };
@@ -286,15 +366,104 @@ namespace tsh {
         NON_MOVEABLE(RandomGenerator);
 
         public:
-            std::random_device rd;
+            /* SplitMix64, so a run can be reproduced from just its seed. */
+            std::uint64_t state;
+
+            ALWAYS_INLINE RandomGenerator() : state(FreshSeed()) { }
+
+            static std::uint64_t FreshSeed() {
+                std::random_device rd;
+
+                return (static_cast<std::uint64_t>(rd()) << 32) | rd();
+            }
+
+            ALWAYS_INLINE constexpr void Seed(const std::uint64_t seed) {
+                this->state = seed;
+            }
+
+            ALWAYS_INLINE constexpr std::uint64_t Next() {
+                this->state += 0x9E3779B97F4A7C15;
+
+                auto z = this->state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+
+                return z ^ (z >> 31);
+            }
+
+            ALWAYS_INLINE constexpr std::uint8_t RandomU8() {
+                return static_cast<std::uint8_t>(this->Next() >> 56);
+            }
+    };
+
+    /*
+        A machine's memory as one flat block, so every access is a single
+        index. Copies share the block until one of them writes, which
+        first takes a block of its own, so forking a machine costs nothing
+        until it changes memory.
+    */
+    class SharedMemory {
+        public:
+            static constexpr std::size_t Size = 0x1000;
+
+            /* Addresses past the end wrap around, which is only cheap for a power of two. */
+            static_assert(std::has_single_bit(Size));
+
+            using Bytes = std::array<std::byte, Size>;
+
+            struct Block {
+                Bytes bytes = {};
+
+                /*
+                    Set as soon as a second copy can see the block, and never
+                    cleared, rather than trusting a reference count another
+                    thread could be changing. At worst a copy left holding the
+                    block alone copies it once more than it had to.
+                */
+                std::atomic<bool> shared = false;
+            };
+
+            std::shared_ptr<Block> block;
+
+            /* Starts as a block of zeroes. */
+            SharedMemory();
+
+            SharedMemory(const SharedMemory &other);
+            SharedMemory &operator =(const SharedMemory &other);
+
+            [[nodiscard]]
+            ALWAYS_INLINE static constexpr std::size_t Wrap(const std::size_t address) {
+                return address & (Size - 1);
+            }
 
-            std::uniform_int_distribution<std::uint8_t> u8_dist;
+            [[nodiscard]]
+            ALWAYS_INLINE std::byte operator [](const std::size_t address) const {
+                return this->block->bytes[Wrap(address)];
+            }
+
+            ALWAYS_INLINE void Write(const std::size_t address, const std::byte value) {
+                this->Writable()[Wrap(address)] = value;
+            }
+
+            void ReadBytes(const std::size_t address, const std::span<std::byte> out) const;
+            void WriteBytes(const std::size_t address, const std::span<const std::byte> in);
 
-            ALWAYS_INLINE RandomGenerator() : u8_dist(0, 255) { }
+            /* Whether both copies still read the very same bytes. */
+            [[nodiscard]]
+            ALWAYS_INLINE bool Shares(const SharedMemory &other) const {
+                return this->block == other.block;
+            }
+
+            /* Takes a block of our own first if anyone else might see this one. When all of it is about to be overwritten, the copy can be skipped. */
+            ALWAYS_INLINE Bytes &Writable(const bool keep_contents = true) {
+                if (this->block->shared.load(std::memory_order_acquire)) [[unlikely]] {
+                    this->Unshare(keep_contents);
+                }
 
-            ALWAYS_INLINE std::uint8_t RandomU8() {
-                return this->u8_dist(rd);
+                return this->block->bytes;
             }
+
+            void Unshare(const bool keep_contents);
     };
 
     class Chip8 {
@@ -307,9 +476,38 @@ namespace tsh {
             static constexpr auto ProgramSpace = AddressSpace(0x0200, 0x1000);
 
             static_assert(DigitSpace.end <= ProgramSpace.start);
+            static_assert(TotalSpace.Size() == SharedMemory::Size);
+
+            /* As deep as most interpreters allowed. */
+            static constexpr std::size_t StackDepth = 16;
+
+            enum class FaultKind : std::uint8_t {
+                None,
+                StackOverflow,
+                StackUnderflow,
+                UnknownOpcode,
+            };
+
+            static constexpr auto FaultNames = util::Map(
+                std::string_view("unknown fault"),
+
+                std::pair{FaultKind::StackOverflow,  std::string_view("stack overflow")},
+                std::pair{FaultKind::StackUnderflow, std::string_view("stack underflow")},
+                std::pair{FaultKind::UnknownOpcode,  std::string_view("unknown opcode")}
+            );
+
+            static constexpr std::uint32_t StateMagic   = 0x53485354; /* "TSHS" */
+            static constexpr std::uint16_t StateVersion = 1;
+
+            static constexpr std::size_t InstructionsPerFrame = 1000;
 
             static constexpr auto FrameDuration       = std::chrono::duration<double>(1.0 / 60);
-            static constexpr auto InstructionDuration = FrameDuration / 1000;
+            static constexpr auto InstructionDuration = FrameDuration / InstructionsPerFrame;
+
+            /* Held to wind back through the snapshots kept by rewind. */
+            static constexpr auto RewindKey = sf::Keyboard::BackSpace;
+
+            static constexpr auto PresentInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(FrameDuration);
 
             using Instructions = InstructionHandler<
                 CLS,
@@ -351,7 +549,7 @@ namespace tsh {
                 BYTE
             >;
 
-            std::array<std::byte, TotalSpace.Size()> memory = {};
+            SharedMemory memory = BootMemory();
 
             Display display;
 
@@ -370,7 +568,7 @@ namespace tsh {
             /* Sound timer. */
             Timer<std::uint8_t> ST;
 
-            std::stack<Address> stack;
+            util::FixedStack<Address, StackDepth> stack;
 
             Keyboard keyboard;
 
@@ -378,21 +576,59 @@ namespace tsh {
 
             RandomGenerator rng;
 
-            ALWAYS_INLINE Chip8() {
-                /*
-                    The compiler didn't optimize copying each digit separately as
-                    well as I would've hoped, so copy all of them in one fell swoop.
-                */
-                const auto raw_digits = reinterpret_cast<const std::byte *>(Digits.data());
-                std::memcpy(this->memory.data() + DigitSpace.start, raw_digits, sizeof(Digits));
-            }
+            /* Receives every presented frame if set. */
+            FrameCapture *capture = nullptr;
+
+            /* Blends frames together before presenting if set. */
+            Phosphor *phosphor = nullptr;
+
+            /* Records the input of every frame if set. */
+            InputMovie *recording = nullptr;
+
+            /* Overrides the input of every frame if set. */
+            MoviePlayer *replay = nullptr;
+
+            /* Keeps snapshots to wind back to while the rewind key is held if set. */
+            Rewind *rewind = nullptr;
+
+            /* Collects the hash of every presented frame if set. */
+            std::vector<std::uint64_t> *frame_hashes = nullptr;
+
+            /* Set by instructions which want the rest of the frame skipped. */
+            bool frame_yielded = false;
+
+            /* Set by instructions which can't carry on. */
+            FaultKind fault = FaultKind::None;
+
+            /* Where the fault happened and what was being run there. */
+            Address fault_address = 0;
+            RawOpcode fault_opcode = 0;
+
+            /* Instructions executed so far. */
+            std::uint64_t cycles = 0;
+
+            ALWAYS_INLINE Chip8() = default;
+
+            /* Memory holding just the digits, which every new machine shares. */
+            static const SharedMemory &BootMemory();
+
+            /*
+                A new machine in exactly the same state, sharing memory
+                until either side writes to it. None of the
+                hooks are carried over.
+            */
+            [[nodiscard]]
+            std::unique_ptr<Chip8> Fork() const;
 
             bool PropagateEvent(const sf::Event &event);
 
+            void PrintFault() const;
+
             template<typename... Args>
             [[nodiscard]]
-            ALWAYS_INLINE constexpr bool LoadProgram(Args &&... args) {
-                return LoadProgramIntoBuffer(this->memory.begin() + ProgramSpace.start, std::forward<Args>(args)...).has_value();
+            ALWAYS_INLINE bool LoadProgram(Args &&... args) {
+                /* Straight into memory. Nothing is written unless the whole program fits. */
+                return LoadProgramIntoBuffer(this->memory.Writable().begin() + ProgramSpace.start, std::forward<Args>(args)...).has_value();
             }
 
             template<std::output_iterator<std::byte> OutputIt>
@@ -407,45 +643,58 @@ namespace tsh {
                 return data.size();
             }
 
+            /* Reads until EOF, for anything which can't be mapped. */
             template<std::output_iterator<std::byte> OutputIt>
             [[nodiscard]]
-            static std::optional<std::size_t> LoadProgramIntoBuffer(OutputIt &&out, const std::string &path) {
-                const auto fp = std::fopen(path.c_str(), "rb");
-                if (fp == nullptr) {
-                    return {};
-                }
-
-                ON_SCOPE_EXIT { std::fclose(fp); };
+            static std::optional<std::size_t> LoadProgramIntoBuffer(OutputIt &&out, std::FILE *fp) {
+                /* One extra byte so we can tell when a program is too big. */
+                std::array<std::byte, ProgramSpace.Size() + 1> data;
+
+                std::size_t size = 0;
+                while (size < data.size()) {
+                    const auto read = std::fread(data.data() + size, 1, data.size() - size, fp);
+                    if (read == 0) {
+                        break;
+                    }
 
-                if (std::fseek(fp, 0, SEEK_END) != 0) {
-                    return {};
+                    size += read;
                 }
 
-                const auto offset = std::ftell(fp);
-                if (offset < 0) {
+                if (std::ferror(fp) != 0) {
                     return {};
                 }
 
-                const auto size = static_cast<std::size_t>(offset);
+                return LoadProgramIntoBuffer(std::forward<OutputIt>(out), std::span(data.data(), size));
+            }
 
-                if (size > ProgramSpace.Size()) {
-                    return {};
+            /* A path of "-" reads from stdin. */
+            template<std::output_iterator<std::byte> OutputIt>
+            [[nodiscard]]
+            static std::optional<std::size_t> LoadProgramIntoBuffer(OutputIt &&out, const std::string &path) {
+                if (path == "-") {
+                    return LoadProgramIntoBuffer(std::forward<OutputIt>(out), stdin);
                 }
 
-                if (std::fseek(fp, 0, SEEK_SET) != 0) {
-                    return {};
+                util::MappedFile file;
+                if (file.Open(path)) {
+                    return LoadProgramIntoBuffer(std::forward<OutputIt>(out), file.Span());
                 }
 
-                const auto data = std::make_unique<std::byte[]>(size);
-                if (std::fread(data.get(), size, 1, fp) != 1) {
+                const auto fp = std::fopen(path.c_str(), "rb");
+                if (fp == nullptr) {
                     return {};
                 }
 
-                return LoadProgramIntoBuffer(std::forward<OutputIt>(out), std::span(data.get(), size));
+                ON_SCOPE_EXIT { std::fclose(fp); };
+
+                return LoadProgramIntoBuffer(std::forward<OutputIt>(out), fp);
             }
 
-            ALWAYS_INLINE constexpr RawOpcode ReadRawOpcode() const {
-                return ReadRawOpcodeFromBuffer(std::span(this->memory.data() + this->PC.Get(), sizeof(RawOpcode)));
+            ALWAYS_INLINE RawOpcode ReadRawOpcode() const {
+                std::array<std::byte, sizeof(RawOpcode)> data;
+                this->memory.ReadBytes(this->PC.Get(), data);
+
+                return ReadRawOpcodeFromBuffer(data);
             }
 
             static constexpr RawOpcode ReadRawOpcodeFromBuffer(const std::span<const std::byte> data) {
@@ -462,10 +711,48 @@ namespace tsh {
                 return raw_op;
             }
 
+            ALWAYS_INLINE constexpr void YieldFrame() {
+                this->frame_yielded = true;
+            }
+
+            ALWAYS_INLINE constexpr void Fault(const FaultKind kind) {
+                this->fault = kind;
+            }
+
+            /* Header, memory, registers, timers, stack, rng, display and keyboard. */
+            static constexpr std::size_t StateSize =
+                sizeof(std::uint32_t) + 2 * sizeof(std::uint16_t) +
+                TotalSpace.Size() +
+                0x10 * sizeof(std::uint8_t) + 2 * sizeof(Address) +
+                2 * sizeof(std::uint8_t) +
+                sizeof(std::uint8_t) + StackDepth * sizeof(Address) +
+                sizeof(std::uint64_t) +
+                Display::DisplayHeight * sizeof(Display::RowType) +
+                sizeof(Keyboard::KeyMask) + sizeof(Key);
+
+            /* Writes the whole machine to a fixed-size blob. */
+            [[nodiscard]]
+            bool SaveState(const std::span<std::byte> out) const;
+
+            [[nodiscard]]
+            bool LoadState(const std::span<const std::byte> in);
+
             [[nodiscard]]
             bool Tick();
 
+            void StepTimers();
+
+            /* Runs a frame's worth of instructions, then steps the timers. */
+            [[nodiscard]]
+            bool RunFrame();
+
+            void PresentFrame();
+
             void Loop();
+
+            /* Runs without a window and as fast as possible. */
+            [[nodiscard]]
+            bool RunHeadless(const std::size_t frames);
     };
 
 }
@@ -0,0 +1,233 @@
+#include "common.hpp"
+#include "assemble.hpp"
+#include "expand.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        constexpr std::string_view ConstantDirective = ".equ";
+        constexpr std::string_view MacroDirective    = ".macro";
+        constexpr std::string_view MacroEnd          = ".endm";
+        constexpr std::string_view RepeatDirective   = ".rept";
+        constexpr std::string_view RepeatEnd         = ".endr";
+
+        /* Enough to find block boundaries without lexing every operand. */
+        ALWAYS_INLINE std::string_view MnemonicOf(const std::string_view line) {
+            return line.substr(0, std::ranges::find_if(line, Statement::IsSpace) - line.begin());
+        }
+
+    }
+
+    std::string_view Expander::Substitute(const std::string_view operand, const Bindings &bindings) const {
+        /* Parameters shadow constants. */
+        for (const auto i : std::views::iota(std::size_t{0}, bindings.count)) {
+            if (bindings.names[i] == operand) {
+                return bindings.values[i];
+            }
+        }
+
+        const auto it = this->constants.find(operand);
+        if (it != this->constants.end()) {
+            return it->second;
+        }
+
+        return operand;
+    }
+
+    std::optional<Expression::Value> Expander::Evaluate(const std::string_view expression, const std::size_t depth) const {
+        if (depth == Expression::MaxDepth) {
+            return {};
+        }
+
+        /* Labels have no addresses yet, so only constants can be used. */
+        return Expression::Evaluate(expression, [&](const std::string_view atom) -> std::optional<Expression::Value> {
+            const auto constant = this->constants.find(atom);
+            if (constant != this->constants.end()) {
+                return this->Evaluate(constant->second, depth + 1);
+            }
+
+            const auto number = Assembler::ToNumber<std::uint64_t>(atom);
+            if (!number.has_value() || *number > static_cast<std::uint64_t>(std::numeric_limits<Expression::Value>::max())) {
+                return {};
+            }
+
+            return static_cast<Expression::Value>(*number);
+        });
+    }
+
+    bool Expander::CountExpanded(const std::string_view line) {
+        this->expanded++;
+
+        if (this->expanded > MaxExpanded) {
+            fmt::print("Expansion too large: {}\n", line);
+            return false;
+        }
+
+        return true;
+    }
+
+    std::optional<std::size_t> Expander::FindClose(const std::size_t first, const std::size_t last, const std::string_view open, const std::string_view close) const {
+        std::size_t nesting = 0;
+
+        for (const auto i : std::views::iota(first, last)) {
+            const auto mnemonic = MnemonicOf(this->lines[i]);
+
+            if (mnemonic == open) {
+                nesting++;
+            } else if (mnemonic == close) {
+                if (nesting == 0) {
+                    return i;
+                }
+
+                nesting--;
+            }
+        }
+
+        return {};
+    }
+
+    bool Expander::ExpandLines(const std::size_t first, const std::size_t last, const Bindings &bindings, const std::size_t depth) {
+        auto i = first;
+
+        while (i < last) {
+            const auto line = this->lines[i];
+
+            if (depth > 0 && !this->CountExpanded(line)) {
+                return false;
+            }
+
+            auto statement = Statement::Lex(line);
+            if (!statement.has_value()) {
+                fmt::print("Failed to parse line: {}\n", line);
+                return false;
+            }
+
+            if (statement->mnemonic == MacroDirective) {
+                const auto close = this->FindClose(i + 1, last, MacroDirective, MacroEnd);
+                if (!close.has_value() || statement->operand_count == 0) {
+                    fmt::print("Malformed macro: {}\n", line);
+                    return false;
+                }
+
+                /* The name and first parameter are only separated by whitespace. */
+                const auto head     = statement->operands[0];
+                const auto name_end = static_cast<std::size_t>(std::ranges::find_if(head, Statement::IsSpace) - head.begin());
+
+                auto macro = Macro{
+                    .first_line = i + 1,
+                    .last_line  = *close,
+                };
+
+                const auto first_param = Statement::Trim(head.substr(name_end));
+                if (!first_param.empty()) {
+                    macro.params[macro.param_count] = first_param;
+                    macro.param_count++;
+                }
+
+                for (const auto param : std::span(statement->operands.data(), statement->operand_count).subspan(1)) {
+                    macro.params[macro.param_count] = param;
+                    macro.param_count++;
+                }
+
+                this->macros.insert_or_assign(head.substr(0, name_end), macro);
+
+                i = *close + 1;
+                continue;
+            }
+
+            if (statement->mnemonic == RepeatDirective) {
+                const auto close = this->FindClose(i + 1, last, RepeatDirective, RepeatEnd);
+                if (!close.has_value() || statement->operand_count != 1) {
+                    fmt::print("Malformed repeat: {}\n", line);
+                    return false;
+                }
+
+                const auto count = this->Evaluate(this->Substitute(statement->operands[0], bindings));
+                if (!count.has_value() || *count < 0) {
+                    fmt::print("Bad repeat count: {}\n", line);
+                    return false;
+                }
+
+                if (depth == MaxDepth) {
+                    fmt::print("Expansion nested too deeply: {}\n", line);
+                    return false;
+                }
+
+                /* Every repetition of anything else expands at least one line, which is what bounds the work. */
+                const auto empty = *close == i + 1;
+
+                for ([[maybe_unused]] const auto repetition : std::views::iota(Expression::Value{0}, empty ? 0 : *count)) {
+                    if (!this->ExpandLines(i + 1, *close, bindings, depth + 1)) {
+                        return false;
+                    }
+                }
+
+                i = *close + 1;
+                continue;
+            }
+
+            if (statement->mnemonic == MacroEnd || statement->mnemonic == RepeatEnd) {
+                fmt::print("Unmatched end of block: {}\n", line);
+                return false;
+            }
+
+            if (statement->mnemonic == ConstantDirective) {
+                if (statement->operand_count != 2) {
+                    fmt::print("Malformed constant: {}\n", line);
+                    return false;
+                }
+
+                /* Operands are substituted as they are expanded but expressions see the final table, so a constant can only mean one thing. */
+                if (!this->constants.try_emplace(statement->operands[0], this->Substitute(statement->operands[1], bindings)).second) {
+                    fmt::print("Constant redefined: {}\n", line);
+                    return false;
+                }
+
+                i++;
+                continue;
+            }
+
+            for (auto &operand : std::span(statement->operands.data(), statement->operand_count)) {
+                operand = this->Substitute(operand, bindings);
+            }
+
+            const auto macro = this->macros.find(statement->mnemonic);
+            if (macro != this->macros.end()) {
+                /* Copied, since the body may define a macro of the same name. */
+                const auto definition = macro->second;
+
+                if (statement->operand_count != definition.param_count) {
+                    fmt::print("Wrong number of arguments for macro: {}\n", line);
+                    return false;
+                }
+
+                if (depth == MaxDepth) {
+                    fmt::print("Expansion nested too deeply: {}\n", line);
+                    return false;
+                }
+
+                const auto inner = Bindings{
+                    .names  = definition.params,
+                    .values = statement->operands,
+                    .count  = definition.param_count,
+                };
+
+                if (!this->ExpandLines(definition.first_line, definition.last_line, inner, depth + 1)) {
+                    return false;
+                }
+
+                i++;
+                continue;
+            }
+
+            this->statements.push_back(*statement);
+            this->statement_lines.push_back(line);
+
+            i++;
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "common.hpp"
+#include "statement.hpp"
+#include "expression.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    /*
+        Expands .equ constants, .macro definitions and .rept blocks
+        straight into the statements handed to the label pass.
+
+        Bodies are remembered as ranges of source lines and lexed again
+        for every expansion, so an unrolled loop never exists as text.
+        Constants and macro parameters replace whole operands. A label in a
+        body expanded more than once is defined twice, which the label
+        pass rejects.
+    */
+    class Expander {
+        NON_COPYABLE(Expander);
+        NON_MOVEABLE(Expander);
+
+        public:
+            /* Deep enough for any real nesting, shallow enough to catch a macro using itself. */
+            static constexpr std::size_t MaxDepth = 64;
+
+            /* Lines expanded out of bodies. Far more than a full program space needs, but runaway repeats and macros still stop early. */
+            static constexpr std::size_t MaxExpanded = 64 * Chip8::ProgramSpace.Size();
+
+            using Names = std::array<std::string_view, Statement::MaxOperands>;
+
+            struct Bindings {
+                Names names  = {};
+                Names values = {};
+
+                std::size_t count = 0;
+            };
+
+            struct Macro {
+                Names params = {};
+                std::size_t param_count = 0;
+
+                /* Source lines between .macro and .endm. */
+                std::size_t first_line;
+                std::size_t last_line;
+            };
+
+            std::span<const std::string_view> lines;
+
+            /* Every statement along with the source line it came from. */
+            std::vector<Statement> &statements;
+            std::vector<std::string_view> &statement_lines;
+
+            std::unordered_map<std::string_view, std::string_view> constants;
+            std::unordered_map<std::string_view, Macro> macros;
+
+            /* Lines expanded out of bodies so far. */
+            std::size_t expanded = 0;
+
+            ALWAYS_INLINE Expander(const std::span<const std::string_view> lines, std::vector<Statement> &statements, std::vector<std::string_view> &statement_lines)
+                : lines(lines), statements(statements), statement_lines(statement_lines) { }
+
+            [[nodiscard]]
+            ALWAYS_INLINE bool Expand() {
+                return this->ExpandLines(0, this->lines.size(), Bindings{}, 0);
+            }
+
+            [[nodiscard]]
+            bool ExpandLines(const std::size_t first, const std::size_t last, const Bindings &bindings, const std::size_t depth);
+
+            /* For repeat counts, which are needed before any label has an address. */
+            [[nodiscard]]
+            std::optional<Expression::Value> Evaluate(const std::string_view expression, const std::size_t depth = 0) const;
+
+            [[nodiscard]]
+            std::string_view Substitute(const std::string_view operand, const Bindings &bindings) const;
+
+            /* Counts one more expanded line, failing once there have been too many. */
+            [[nodiscard]]
+            bool CountExpanded(const std::string_view line);
+
+            /* Finds the line closing the block opened just before first, skipping over nested blocks. */
+            [[nodiscard]]
+            std::optional<std::size_t> FindClose(const std::size_t first, const std::size_t last, const std::string_view open, const std::string_view close) const;
+    };
+
+}
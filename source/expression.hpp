@@ -0,0 +1,251 @@
+#pragma once
+
+#include "common.hpp"
+#include "statement.hpp"
+
+namespace tsh {
+
+    /*
+        Constant expressions in operands, folded at assembly time.
+
+        From loosest to tightest binding: |, &, << >>, + -, *, then
+        unary minus and parentheses. Numbers and names are atoms, which
+        the caller resolves to values.
+    */
+    class Expression {
+        public:
+            using Value = std::int64_t;
+
+            /* Names defined through other names give up past this depth, which catches cycles. */
+            static constexpr std::size_t MaxDepth = 16;
+
+            [[nodiscard]]
+            static constexpr bool IsAtomChar(const char c) {
+                return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' || c == '.';
+            }
+
+            /* Whether any atom in the text satisfies the predicate. */
+            template<typename Predicate>
+            [[nodiscard]]
+            static constexpr bool AnyAtom(std::string_view text, Predicate &&predicate) {
+                while (!text.empty()) {
+                    const auto atom_end = static_cast<std::size_t>(std::ranges::find_if_not(text, IsAtomChar) - text.begin());
+                    if (atom_end == 0) {
+                        text.remove_prefix(1);
+                        continue;
+                    }
+
+                    if (predicate(text.substr(0, atom_end))) {
+                        return true;
+                    }
+
+                    text.remove_prefix(atom_end);
+                }
+
+                return false;
+            }
+
+            template<typename Resolve>
+            class Parser {
+                public:
+                    std::string_view rest;
+                    Resolve &resolve;
+
+                    ALWAYS_INLINE constexpr Parser(const std::string_view text, Resolve &resolve) : rest(text), resolve(resolve) { }
+
+                    constexpr bool Accept(const std::string_view token) {
+                        this->rest = Statement::Trim(this->rest);
+
+                        if (!this->rest.starts_with(token)) {
+                            return false;
+                        }
+
+                        this->rest.remove_prefix(token.size());
+
+                        return true;
+                    }
+
+                    constexpr std::optional<Value> Or() {
+                        auto value = this->And();
+
+                        while (value.has_value() && this->Accept("|")) {
+                            const auto rhs = this->And();
+                            if (!rhs.has_value()) {
+                                return {};
+                            }
+
+                            *value |= *rhs;
+                        }
+
+                        return value;
+                    }
+
+                    constexpr std::optional<Value> And() {
+                        auto value = this->Shift();
+
+                        while (value.has_value() && this->Accept("&")) {
+                            const auto rhs = this->Shift();
+                            if (!rhs.has_value()) {
+                                return {};
+                            }
+
+                            *value &= *rhs;
+                        }
+
+                        return value;
+                    }
+
+                    constexpr std::optional<Value> Shift() {
+                        auto value = this->Sum();
+
+                        while (value.has_value()) {
+                            const auto left = this->Accept("<<");
+                            if (!left && !this->Accept(">>")) {
+                                break;
+                            }
+
+                            const auto rhs = this->Sum();
+                            if (!rhs.has_value() || *rhs < 0 || *rhs >= static_cast<Value>(BITSIZEOF(Value))) {
+                                return {};
+                            }
+
+                            if (left) {
+                                /* Bits shifted out, sign included, fail the expression like any other overflow. */
+                                const auto shifted = *value << *rhs;
+                                if ((shifted >> *rhs) != *value) {
+                                    return {};
+                                }
+
+                                *value = shifted;
+                            } else {
+                                *value >>= *rhs;
+                            }
+                        }
+
+                        return value;
+                    }
+
+                    constexpr std::optional<Value> Sum() {
+                        auto value = this->Product();
+
+                        while (value.has_value()) {
+                            const auto add = this->Accept("+");
+                            if (!add && !this->Accept("-")) {
+                                break;
+                            }
+
+                            const auto rhs = this->Product();
+                            if (!rhs.has_value()) {
+                                return {};
+                            }
+
+                            /* Overflowing fails the expression rather than wrapping. */
+                            const auto overflow = add ? __builtin_add_overflow(*value, *rhs, &*value) : __builtin_sub_overflow(*value, *rhs, &*value);
+                            if (overflow) {
+                                return {};
+                            }
+                        }
+
+                        return value;
+                    }
+
+                    constexpr std::optional<Value> Product() {
+                        auto value = this->Unary();
+
+                        while (value.has_value() && this->Accept("*")) {
+                            const auto rhs = this->Unary();
+                            if (!rhs.has_value()) {
+                                return {};
+                            }
+
+                            if (__builtin_mul_overflow(*value, *rhs, &*value)) {
+                                return {};
+                            }
+                        }
+
+                        return value;
+                    }
+
+                    constexpr std::optional<Value> Unary() {
+                        if (this->Accept("-")) {
+                            const auto value = this->Unary();
+
+                            Value negated;
+                            if (!value.has_value() || __builtin_sub_overflow(Value{0}, *value, &negated)) {
+                                return {};
+                            }
+
+                            return negated;
+                        }
+
+                        if (this->Accept("(")) {
+                            const auto value = this->Or();
+                            if (!value.has_value() || !this->Accept(")")) {
+                                return {};
+                            }
+
+                            return value;
+                        }
+
+                        this->rest = Statement::Trim(this->rest);
+
+                        const auto atom_end = static_cast<std::size_t>(std::ranges::find_if_not(this->rest, IsAtomChar) - this->rest.begin());
+                        if (atom_end == 0) {
+                            return {};
+                        }
+
+                        const auto atom = this->rest.substr(0, atom_end);
+                        this->rest.remove_prefix(atom_end);
+
+                        return this->resolve(atom);
+                    }
+            };
+
+            /* Fails on unknown atoms, bad syntax and anything left over. */
+            template<typename Resolve>
+            [[nodiscard]]
+            static constexpr std::optional<Value> Evaluate(const std::string_view text, Resolve &&resolve) {
+                auto parser = Parser<std::remove_reference_t<Resolve>>(text, resolve);
+
+                const auto value = parser.Or();
+                if (!value.has_value() || !Statement::Trim(parser.rest).empty()) {
+                    return {};
+                }
+
+                return value;
+            }
+    };
+
+    static_assert([]() {
+        /* Just enough of a resolver to check the grammar. */
+        const auto number = [](const std::string_view atom) -> std::optional<Expression::Value> {
+            Expression::Value value = 0;
+            for (const auto c : atom) {
+                if (c < '0' || c > '9') {
+                    return {};
+                }
+
+                value = value * 10 + (c - '0');
+            }
+
+            return value;
+        };
+
+        return Expression::Evaluate("1 + 2 * 3", number)      == 7  &&
+               Expression::Evaluate("(1 + 2) * 3", number)    == 9  &&
+               Expression::Evaluate("1 << 4 | 3 & 1", number) == 17 &&
+               Expression::Evaluate("8 - 2 - 1", number)      == 5  &&
+               Expression::Evaluate("-2 * 3", number)         == -6 &&
+               Expression::Evaluate("1 << 62", number)        == Expression::Value{1} << 62 &&
+               Expression::Evaluate("-1 << 63", number)       == std::numeric_limits<Expression::Value>::min() &&
+               !Expression::Evaluate("(1 + 2", number).has_value() &&
+               !Expression::Evaluate("1 2", number).has_value() &&
+               !Expression::Evaluate("(1 << 62) + (1 << 62)", number).has_value() &&
+               !Expression::Evaluate("-(1 << 62) - (1 << 62) - 1", number).has_value() &&
+               !Expression::Evaluate("(1 << 62) * 4", number).has_value() &&
+               !Expression::Evaluate("-(-1 << 63)", number).has_value() &&
+               !Expression::Evaluate("1 << 63", number).has_value() &&
+               !Expression::Evaluate("3 << 62", number).has_value();
+    }());
+
+}
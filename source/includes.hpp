@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <cmath>
 
 #include <limits>
 #include <random>
@@ -10,11 +11,16 @@
 #include <atomic>
 #include <stop_token>
 #include <thread>
+#include <mutex>
+#include <functional>
+#include <deque>
 #include <span>
 #include <string_view>
 #include <string>
+#include <charconv>
 #include <unordered_map>
-#include <stack>
+#include <unordered_set>
+#include <filesystem>
 #include <utility>
 #include <algorithm>
 #include <memory>
@@ -22,6 +28,8 @@
 #include <iterator>
 #include <ranges>
 #include <concepts>
+#include <type_traits>
+#include <bit>
 
 #include <SFML/Graphics.hpp>
 #include <fmt/format.h>
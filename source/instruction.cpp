@@ -14,17 +14,17 @@ namespace tsh {
         PCAdvance name::Execute(Chip8 &ch8, const Opcode op)
 
     #define INSTRUCTION_ASSEMBLE(name) \
-        std::optional<Opcode> name::Assemble([[maybe_unused]] const Assembler &asmbl, const std::string_view ins)
-
-    #define MATCH(pattern) ({                                       \
-        const auto captures = util::WildcardCapture(pattern, ins);  \
-        if (!captures.has_value()) {                                \
-            return {};                                              \
-        }                                                           \
-        *captures;                                                  \
+        std::optional<Opcode> name::Assemble([[maybe_unused]] const Assembler &asmbl, const Statement &ins)
+
+    #define MATCH(...) ({                             \
+        const auto captures = ins.Match(__VA_ARGS__); \
+        if (!captures.has_value()) {                  \
+            return {};                                \
+        }                                             \
+        *captures;                                    \
     })
 
-    #define NOT_MATCH(pattern) if (util::WildcardCapture(pattern, ins).has_value()) return {}
+    #define NOT_MATCH(...) if (ins.Match(__VA_ARGS__).has_value()) return {}
 
     #define MUST_EXIST(expr) ({    \
         auto _value = (expr);      \
@@ -63,8 +63,14 @@ namespace tsh {
     INSTRUCTION_EXECUTE(RET) {
         UNUSED(op);
 
-        ch8.PC.Set(ch8.stack.top());
-        ch8.stack.pop();
+        const auto return_address = ch8.stack.Pop();
+        if (!return_address.has_value()) {
+            ch8.Fault(Chip8::FaultKind::StackUnderflow);
+
+            return 0;
+        }
+
+        ch8.PC.Set(*return_address);
 
         return 1;
     }
@@ -86,9 +92,9 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(JP_Addr) {
-        NOT_MATCH("JP V0, *");
+        NOT_MATCH("JP", "V0", "*");
 
-        const auto captures = MATCH("JP *");
+        const auto captures = MATCH("JP", "*");
         const auto addr     = MUST_EXIST(asmbl.ToAddress(captures[0]));
 
         return Opcode()
@@ -101,14 +107,19 @@ namespace tsh {
     }
 
     INSTRUCTION_EXECUTE(CALL) {
-        ch8.stack.push(ch8.PC.Get());
+        if (!ch8.stack.Push(ch8.PC.Get())) {
+            ch8.Fault(Chip8::FaultKind::StackOverflow);
+
+            return 0;
+        }
+
         ch8.PC.Set(op.Addr());
 
         return 0;
     }
 
     INSTRUCTION_ASSEMBLE(CALL) {
-        const auto captures = MATCH("CALL *");
+        const auto captures = MATCH("CALL", "*");
         const auto addr     = MUST_EXIST(asmbl.ToAddress(captures[0]));
 
         return Opcode()
@@ -129,11 +140,11 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SE_V_Byte) {
-        NOT_MATCH("SE V*, V*");
+        NOT_MATCH("SE", "V*", "V*");
 
-        const auto captures = MATCH("SE V*, *");
+        const auto captures = MATCH("SE", "V*", "*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
-        const auto byte     = MUST_EXIST(Assembler::ToNumber<std::uint8_t>(captures[1]));
+        const auto byte     = MUST_EXIST(asmbl.ToByte(captures[1]));
 
         return Opcode()
             .TopNibble(0x3)
@@ -154,11 +165,11 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SNE_V_Byte) {
-        NOT_MATCH("SNE V* V*");
+        NOT_MATCH("SNE", "V*", "V*");
 
-        const auto captures = MATCH("SNE V*, *");
+        const auto captures = MATCH("SNE", "V*", "*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
-        const auto byte     = MUST_EXIST(Assembler::ToNumber<std::uint8_t>(captures[1]));
+        const auto byte     = MUST_EXIST(asmbl.ToByte(captures[1]));
 
         return Opcode()
             .TopNibble(0x4)
@@ -179,7 +190,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SE_V_V) {
-        const auto captures = MATCH("SE V*, V*");
+        const auto captures = MATCH("SE", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -201,14 +212,14 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_V_Byte) {
-        NOT_MATCH("LD V*, V*");
-        NOT_MATCH("LD V*, DT");
-        NOT_MATCH("LD V*, K");
-        NOT_MATCH("LD V*, [I]");
+        NOT_MATCH("LD", "V*", "V*");
+        NOT_MATCH("LD", "V*", "DT");
+        NOT_MATCH("LD", "V*", "K");
+        NOT_MATCH("LD", "V*", "[I]");
 
-        const auto captures = MATCH("LD V*, *");
+        const auto captures = MATCH("LD", "V*", "*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
-        const auto byte     = MUST_EXIST(Assembler::ToNumber<std::uint8_t>(captures[1]));
+        const auto byte     = MUST_EXIST(asmbl.ToByte(captures[1]));
 
         return Opcode()
             .TopNibble(0x6)
@@ -227,11 +238,11 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(ADD_V_Byte) {
-        NOT_MATCH("ADD V*, V*");
+        NOT_MATCH("ADD", "V*", "V*");
 
-        const auto captures = MATCH("ADD V*, *");
+        const auto captures = MATCH("ADD", "V*", "*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
-        const auto byte     = MUST_EXIST(Assembler::ToNumber<std::uint8_t>(captures[1]));
+        const auto byte     = MUST_EXIST(asmbl.ToByte(captures[1]));
 
         return Opcode()
             .TopNibble(0x7)
@@ -250,7 +261,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_V_V) {
-        const auto captures = MATCH("LD V*, V*");
+        const auto captures = MATCH("LD", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -275,7 +286,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(OR_V_V) {
-        const auto captures = MATCH("OR V*, V*");
+        const auto captures = MATCH("OR", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -300,7 +311,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(AND_V_V) {
-        const auto captures = MATCH("AND V*, V*");
+        const auto captures = MATCH("AND", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -325,7 +336,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(XOR_V_V) {
-        const auto captures = MATCH("XOR V*, V*");
+        const auto captures = MATCH("XOR", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -360,7 +371,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(ADD_V_V) {
-        const auto captures = MATCH("ADD V*, V*");
+        const auto captures = MATCH("ADD", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -391,7 +402,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SUB_V_V) {
-        const auto captures = MATCH("SUB V*, V*");
+        const auto captures = MATCH("SUB", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -422,7 +433,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SHR_V) {
-        const auto captures = MATCH("SHR V*");
+        const auto captures = MATCH("SHR", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -452,7 +463,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SUBN_V_V) {
-        const auto captures = MATCH("SUBN V*, V*");
+        const auto captures = MATCH("SUBN", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -483,7 +494,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SHL_V) {
-        const auto captures = MATCH("SHL V*");
+        const auto captures = MATCH("SHL", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -506,7 +517,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SNE_V_V) {
-        const auto captures = MATCH("SNE V*, V*");
+        const auto captures = MATCH("SNE", "V*", "V*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
 
@@ -528,7 +539,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_I_Addr) {
-        const auto captures = MATCH("LD I, *");
+        const auto captures = MATCH("LD", "I", "*");
         const auto addr     = MUST_EXIST(asmbl.ToAddress(captures[0]));
 
         return Opcode()
@@ -547,7 +558,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(JP_V0_Addr) {
-        const auto captures = MATCH("JP V0, *");
+        const auto captures = MATCH("JP", "V0", "*");
         const auto addr     = MUST_EXIST(asmbl.ToAddress(captures[0]));
 
         return Opcode()
@@ -566,9 +577,9 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(RND) {
-        const auto captures = MATCH("RND V*, *");
+        const auto captures = MATCH("RND", "V*", "*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
-        const auto byte     = MUST_EXIST(Assembler::ToNumber<std::uint8_t>(captures[1]));
+        const auto byte     = MUST_EXIST(asmbl.ToByte(captures[1]));
 
         return Opcode()
             .TopNibble(0xC)
@@ -581,7 +592,10 @@ namespace tsh {
     }
 
     INSTRUCTION_EXECUTE(DRW) {
-        const auto sprite_data = std::span<const std::byte>(ch8.memory.data() + ch8.I.Get(), op.Nibble());
+        std::array<std::byte, 0x10> sprite;
+        const auto sprite_data = std::span(sprite).first(op.Nibble());
+
+        ch8.memory.ReadBytes(ch8.I.Get(), sprite_data);
 
         const auto collide = ch8.display.DrawSprite(ch8.V[op.X()].Get(), ch8.V[op.Y()].Get(), sprite_data);
         if (collide) {
@@ -594,10 +608,10 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(DRW) {
-        const auto captures = MATCH("DRW V*, V*, *");
+        const auto captures = MATCH("DRW", "V*", "V*", "*");
         const auto reg_x    = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
         const auto reg_y    = MUST_EXIST(Assembler::RegisterNibble(captures[1]));
-        const auto height   = MUST_EXIST(Assembler::ToNumber<std::uint8_t>(captures[2]));
+        const auto height   = MUST_EXIST(asmbl.ToByte(captures[2]));
 
         /* If height can't fit in a nibble. */
         if (height > 0xF) {
@@ -616,7 +630,8 @@ namespace tsh {
     }
 
     INSTRUCTION_EXECUTE(SKP) {
-        std::this_thread::sleep_for(Chip8::FrameDuration);
+        /* Keep games which poll the keyboard from running away. */
+        ch8.YieldFrame();
 
         const auto key = static_cast<Key>(ch8.V[op.X()].Get());
 
@@ -628,7 +643,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SKP) {
-        const auto captures = MATCH("SKP V*");
+        const auto captures = MATCH("SKP", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -642,7 +657,7 @@ namespace tsh {
     }
 
     INSTRUCTION_EXECUTE(SKNP) {
-        std::this_thread::sleep_for(Chip8::FrameDuration);
+        ch8.YieldFrame();
 
         const auto key = static_cast<Key>(ch8.V[op.X()].Get());
 
@@ -654,7 +669,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(SKNP) {
-        const auto captures = MATCH("SKNP V*");
+        const auto captures = MATCH("SKNP", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -674,7 +689,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_V_DT) {
-        const auto captures = MATCH("LD V*, DT");
+        const auto captures = MATCH("LD", "V*", "DT");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -700,7 +715,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_V_K) {
-        const auto captures = MATCH("LD V*, K");
+        const auto captures = MATCH("LD", "V*", "K");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -720,7 +735,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_DT_V) {
-        const auto captures = MATCH("LD DT, V*");
+        const auto captures = MATCH("LD", "DT", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -740,7 +755,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_ST_V) {
-        const auto captures = MATCH("LD ST, V*");
+        const auto captures = MATCH("LD", "ST", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -760,7 +775,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(ADD_I_V) {
-        const auto captures = MATCH("ADD I, V*");
+        const auto captures = MATCH("ADD", "I", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -780,7 +795,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_F_V) {
-        const auto captures = MATCH("LD F, V*");
+        const auto captures = MATCH("LD", "F", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -802,7 +817,7 @@ namespace tsh {
         for (const auto offset : std::views::iota(0, MaxPower + 1) | std::views::reverse) {
             const auto digit = num % 10;
 
-            ch8.memory[addr + offset] = static_cast<std::byte>(digit);
+            ch8.memory.Write(addr + offset, static_cast<std::byte>(digit));
 
             num /= 10;
         }
@@ -811,7 +826,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_B_V) {
-        const auto captures = MATCH("LD B, V*");
+        const auto captures = MATCH("LD", "B", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -830,14 +845,14 @@ namespace tsh {
         for (const auto offset : std::views::iota(0, op.X() + 1)) {
             const auto &reg = ch8.V[offset];
 
-            ch8.memory[addr + offset] = static_cast<std::byte>(reg.Get());
+            ch8.memory.Write(addr + offset, static_cast<std::byte>(reg.Get()));
         }
 
         return 1;
     }
 
     INSTRUCTION_ASSEMBLE(LD_DEREF_I_V) {
-        const auto captures = MATCH("LD [I], V*");
+        const auto captures = MATCH("LD", "[I]", "V*");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -863,7 +878,7 @@ namespace tsh {
     }
 
     INSTRUCTION_ASSEMBLE(LD_V_DEREF_I) {
-        const auto captures = MATCH("LD V*, [I]");
+        const auto captures = MATCH("LD", "V*", "[I]");
         const auto reg      = MUST_EXIST(Assembler::RegisterNibble(captures[0]));
 
         return Opcode()
@@ -877,11 +892,11 @@ namespace tsh {
     #undef INSTRUCTION_DISASSEMBLE
 
     #define ASM_ONLY_INSTRUCTION_ASSEMBLE(name) \
-        std::optional<std::uint8_t> name::Assemble([[maybe_unused]] const Assembler &asmbl, const std::string_view ins)
+        std::optional<std::uint8_t> name::Assemble([[maybe_unused]] const Assembler &asmbl, const Statement &ins)
 
     ASM_ONLY_INSTRUCTION_ASSEMBLE(BYTE) {
-        const auto captures = MATCH(".byte *");
-        const auto byte     = MUST_EXIST(Assembler::ToNumber<std::uint8_t>(captures[0]));
+        const auto captures = MATCH(".byte", "*");
+        const auto byte     = MUST_EXIST(asmbl.ToByte(captures[0]));
 
         return byte;
     }
@@ -889,7 +904,7 @@ namespace tsh {
     ASM_ONLY_INSTRUCTION_ASSEMBLE(SPRITE) {
         static constexpr auto Padding = Digit::Padding;
 
-        const auto captures   = MATCH(".sprite \"*\"");
+        const auto captures   = MATCH(".sprite", "\"*\"");
               auto sprite_str = captures[0];
 
         if (sprite_str.size() > BITSIZEOF(std::byte) + 2 * Padding) {
@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "nibble_pattern.hpp"
+#include "statement.hpp"
 
 namespace tsh {
 
@@ -112,7 +113,8 @@ namespace tsh {
     concept AssemblyData = std::same_as<T, std::optional<std::uint8_t>> || std::same_as<T, std::optional<Opcode>>;
 
     template<typename T>
-    concept Instruction = requires(Chip8 &ch8, Opcode op, DisassembleOutputIterator out, const Assembler &asmbl, const std::string_view ins) {
+    concept Instruction = requires(Chip8 &ch8, Opcode op, DisassembleOutputIterator out, const Assembler &asmbl, const Statement &ins) {
+        { T::Mnemonic }             -> std::convertible_to<std::string_view>;
         { T::Compare(op) }          -> std::same_as<bool>;
         { T::Execute(ch8, op) }     -> std::same_as<PCAdvance>;
         { T::Disassemble(out, op) } -> std::same_as<DisassembleOutputIterator>;
@@ -121,10 +123,102 @@ namespace tsh {
 
     template<typename T>
     concept SpecialSizedInstruction = Instruction<T> && requires {
-        T::NameWithTrailingSpace;
         T::Size;
-    } && std::same_as<std::remove_cvref_t<decltype(T::NameWithTrailingSpace)>, std::string_view> &&
-         std::same_as<std::remove_cvref_t<decltype(T::Size)>,                  Address>;
+    } && std::same_as<std::remove_cvref_t<decltype(T::Size)>, Address>;
+
+    /* Writes whatever an instruction assembles to into the output, giving back how many bytes it took. */
+    template<Instruction Ins>
+    [[nodiscard]]
+    std::optional<std::size_t> AssembleInto(const Assembler &asmbl, const Statement &ins, const std::span<std::byte> out) {
+        const auto data = Ins::Assemble(asmbl, ins);
+        if (!data.has_value()) {
+            return {};
+        }
+
+        if constexpr (std::same_as<std::remove_cvref_t<decltype(*data)>, Opcode>) {
+            if (out.size() < sizeof(Opcode)) {
+                return {};
+            }
+
+            out[0] = static_cast<std::byte>(data->Get() >> 8);
+            out[1] = static_cast<std::byte>(data->Get() & 0xFF);
+
+            return sizeof(Opcode);
+        } else {
+            /* Only other option is single uint8_t. */
+
+            if (out.empty()) {
+                return {};
+            }
+
+            out[0] = static_cast<std::byte>(*data);
+
+            return sizeof(std::uint8_t);
+        }
+    }
+
+    /* Every instruction sorted by mnemonic, so a line only tries the instructions it could be. */
+    template<Instruction... Ins>
+    class MnemonicTable {
+        public:
+            using AssembleFunction = std::optional<std::size_t> (*)(const Assembler &, const Statement &, std::span<std::byte>);
+
+            struct Entry {
+                std::string_view mnemonic;
+
+                /* Keeps instructions sharing a mnemonic in declaration order. */
+                std::size_t order;
+
+                AssembleFunction assemble;
+
+                [[nodiscard]]
+                ALWAYS_INLINE constexpr bool operator <(const Entry &other) const {
+                    if (this->mnemonic != other.mnemonic) {
+                        return this->mnemonic < other.mnemonic;
+                    }
+
+                    return this->order < other.order;
+                }
+            };
+
+            static constexpr auto Entries = []() {
+                std::size_t order = 0;
+
+                auto entries = std::array{Entry{Ins::Mnemonic, order++, &AssembleInto<Ins>}...};
+                std::sort(entries.begin(), entries.end());
+
+                return entries;
+            }();
+
+            [[nodiscard]]
+            static std::optional<std::size_t> Assemble(const Assembler &asmbl, const Statement &ins, const std::span<std::byte> out) {
+                const auto candidates = std::ranges::equal_range(Entries, ins.mnemonic, {}, &Entry::mnemonic);
+
+                for (const auto &entry : candidates) {
+                    const auto size = entry.assemble(asmbl, ins, out);
+                    if (size.has_value()) {
+                        return size;
+                    }
+                }
+
+                return {};
+            }
+
+            [[nodiscard]]
+            static constexpr Address Size(const std::string_view mnemonic) {
+                Address size = sizeof(Opcode);
+
+                ([&]() {
+                    if constexpr (SpecialSizedInstruction<Ins>) {
+                        if (mnemonic == Ins::Mnemonic) {
+                            size = Ins::Size;
+                        }
+                    }
+                }(), ...);
+
+                return size;
+            }
+    };
 
 
     template<Instruction Ins, typename... Ts>
@@ -152,33 +246,13 @@ namespace tsh {
             }
 
             [[nodiscard]]
-            static std::optional<std::vector<std::byte>> Assemble(const Assembler &asmbl, const std::string_view ins) {
-                const auto data = Ins::Assemble(asmbl, ins);
-                if (data.has_value()) {
-                    if constexpr (std::same_as<std::remove_cvref_t<decltype(*data)>, Opcode>) {
-                        return std::vector{
-                            static_cast<std::byte>(data->Get() >> 8),
-                            static_cast<std::byte>(data->Get() & 0xFF),
-                        };
-                    } else {
-                        /* Only other option is single uint8_t. */
-
-                        return std::vector{static_cast<std::byte>(*data)};
-                    }
-                }
-
-                return InstructionHandler<Ts...>::Assemble(asmbl, ins);
+            static std::optional<std::size_t> Assemble(const Assembler &asmbl, const Statement &ins, const std::span<std::byte> out) {
+                return MnemonicTable<Ins, Ts...>::Assemble(asmbl, ins, out);
             }
 
             [[nodiscard]]
-            static constexpr Address Size(const std::string_view ins) {
-                if constexpr (SpecialSizedInstruction<Ins>) {
-                    if (Ins::NameWithTrailingSpace == ins.substr(0, Ins::NameWithTrailingSpace.size())) {
-                        return Ins::Size;
-                    }
-                }
-
-                return InstructionHandler<Ts...>::Size(ins);
+            static constexpr Address Size(const std::string_view mnemonic) {
+                return MnemonicTable<Ins, Ts...>::Size(mnemonic);
             }
     };
 
@@ -208,40 +282,21 @@ namespace tsh {
             }
 
             [[nodiscard]]
-            static std::optional<std::vector<std::byte>> Assemble(const Assembler &asmbl, const std::string_view ins) {
-                const auto data = Ins::Assemble(asmbl, ins);
-                if (data.has_value()) {
-                    if constexpr (std::same_as<std::remove_cvref_t<decltype(*data)>, Opcode>) {
-                        return std::vector{
-                            static_cast<std::byte>(data->Get() >> 8),
-                            static_cast<std::byte>(data->Get() & 0xFF),
-                        };
-                    } else {
-                        /* Only other option is single uint8_t. */
-
-                        return std::vector{static_cast<std::byte>(*data)};
-                    }
-                }
-
-                return {};
+            static std::optional<std::size_t> Assemble(const Assembler &asmbl, const Statement &ins, const std::span<std::byte> out) {
+                return MnemonicTable<Ins>::Assemble(asmbl, ins, out);
             }
 
             [[nodiscard]]
-            static constexpr Address Size(const std::string_view ins) {
-                if constexpr (SpecialSizedInstruction<Ins>) {
-                    if (Ins::NameWithTrailingSpace == ins.substr(0, Ins::NameWithTrailingSpace.size())) {
-                        return Ins::Size;
-                    }
-                }
-
-                return sizeof(Opcode);
+            static constexpr Address Size(const std::string_view mnemonic) {
+                return MnemonicTable<Ins>::Size(mnemonic);
             }
     };
 
-    #define INSTRUCTION_DECLARE(name, pattern)                                                                      \
+    #define INSTRUCTION_DECLARE(name, pattern, mnemonic)                                                          \
         class name {                                                                                                \
             public:                                                                                                 \
                 static constexpr auto Pattern = NibblePattern(pattern);                                             \
+                static constexpr std::string_view Mnemonic = mnemonic;                                              \
                 [[nodiscard]]                                                                                       \
                 ALWAYS_INLINE static constexpr bool Compare(const Opcode op) {                                      \
                     return Pattern.matches(op.Get());                                                               \
@@ -251,51 +306,51 @@ namespace tsh {
                 [[nodiscard]]                                                                                       \
                 static DisassembleOutputIterator Disassemble(const DisassembleOutputIterator out, const Opcode op); \
                 [[nodiscard]]                                                                                       \
-                static std::optional<Opcode> Assemble(const Assembler &asmbl, const std::string_view ins);          \
+                static std::optional<Opcode> Assemble(const Assembler &asmbl, const Statement &ins);                \
         }
 
-    INSTRUCTION_DECLARE(CLS,          "00E0");
-    INSTRUCTION_DECLARE(RET,          "00EE");
-    INSTRUCTION_DECLARE(JP_Addr,      "1xxx");
-    INSTRUCTION_DECLARE(CALL,         "2xxx");
-    INSTRUCTION_DECLARE(SE_V_Byte,    "3xxx");
-    INSTRUCTION_DECLARE(SNE_V_Byte,   "4xxx");
-    INSTRUCTION_DECLARE(SE_V_V,       "5xx0");
-    INSTRUCTION_DECLARE(LD_V_Byte,    "6xxx");
-    INSTRUCTION_DECLARE(ADD_V_Byte,   "7xxx");
-    INSTRUCTION_DECLARE(LD_V_V,       "8xx0");
-    INSTRUCTION_DECLARE(OR_V_V,       "8xx1");
-    INSTRUCTION_DECLARE(AND_V_V,      "8xx2");
-    INSTRUCTION_DECLARE(XOR_V_V,      "8xx3");
-    INSTRUCTION_DECLARE(ADD_V_V,      "8xx4");
-    INSTRUCTION_DECLARE(SUB_V_V,      "8xx5");
-    INSTRUCTION_DECLARE(SHR_V,        "8xx6");
-    INSTRUCTION_DECLARE(SUBN_V_V,     "8xx7");
-    INSTRUCTION_DECLARE(SHL_V,        "8xxE");
-    INSTRUCTION_DECLARE(SNE_V_V,      "9xx0");
-    INSTRUCTION_DECLARE(LD_I_Addr,    "Axxx");
-    INSTRUCTION_DECLARE(JP_V0_Addr,   "Bxxx");
-    INSTRUCTION_DECLARE(RND,          "Cxxx");
-    INSTRUCTION_DECLARE(DRW,          "Dxxx");
-    INSTRUCTION_DECLARE(SKP,          "Ex9E");
-    INSTRUCTION_DECLARE(SKNP,         "ExA1");
-    INSTRUCTION_DECLARE(LD_V_DT,      "Fx07");
-    INSTRUCTION_DECLARE(LD_V_K,       "Fx0A");
-    INSTRUCTION_DECLARE(LD_DT_V,      "Fx15");
-    INSTRUCTION_DECLARE(LD_ST_V,      "Fx18");
-    INSTRUCTION_DECLARE(ADD_I_V,      "Fx1E");
-    INSTRUCTION_DECLARE(LD_F_V,       "Fx29");
-    INSTRUCTION_DECLARE(LD_B_V,       "Fx33");
-    INSTRUCTION_DECLARE(LD_DEREF_I_V, "Fx55");
-    INSTRUCTION_DECLARE(LD_V_DEREF_I, "Fx65");
+    INSTRUCTION_DECLARE(CLS,          "00E0", "CLS");
+    INSTRUCTION_DECLARE(RET,          "00EE", "RET");
+    INSTRUCTION_DECLARE(JP_Addr,      "1xxx", "JP");
+    INSTRUCTION_DECLARE(CALL,         "2xxx", "CALL");
+    INSTRUCTION_DECLARE(SE_V_Byte,    "3xxx", "SE");
+    INSTRUCTION_DECLARE(SNE_V_Byte,   "4xxx", "SNE");
+    INSTRUCTION_DECLARE(SE_V_V,       "5xx0", "SE");
+    INSTRUCTION_DECLARE(LD_V_Byte,    "6xxx", "LD");
+    INSTRUCTION_DECLARE(ADD_V_Byte,   "7xxx", "ADD");
+    INSTRUCTION_DECLARE(LD_V_V,       "8xx0", "LD");
+    INSTRUCTION_DECLARE(OR_V_V,       "8xx1", "OR");
+    INSTRUCTION_DECLARE(AND_V_V,      "8xx2", "AND");
+    INSTRUCTION_DECLARE(XOR_V_V,      "8xx3", "XOR");
+    INSTRUCTION_DECLARE(ADD_V_V,      "8xx4", "ADD");
+    INSTRUCTION_DECLARE(SUB_V_V,      "8xx5", "SUB");
+    INSTRUCTION_DECLARE(SHR_V,        "8xx6", "SHR");
+    INSTRUCTION_DECLARE(SUBN_V_V,     "8xx7", "SUBN");
+    INSTRUCTION_DECLARE(SHL_V,        "8xxE", "SHL");
+    INSTRUCTION_DECLARE(SNE_V_V,      "9xx0", "SNE");
+    INSTRUCTION_DECLARE(LD_I_Addr,    "Axxx", "LD");
+    INSTRUCTION_DECLARE(JP_V0_Addr,   "Bxxx", "JP");
+    INSTRUCTION_DECLARE(RND,          "Cxxx", "RND");
+    INSTRUCTION_DECLARE(DRW,          "Dxxx", "DRW");
+    INSTRUCTION_DECLARE(SKP,          "Ex9E", "SKP");
+    INSTRUCTION_DECLARE(SKNP,         "ExA1", "SKNP");
+    INSTRUCTION_DECLARE(LD_V_DT,      "Fx07", "LD");
+    INSTRUCTION_DECLARE(LD_V_K,       "Fx0A", "LD");
+    INSTRUCTION_DECLARE(LD_DT_V,      "Fx15", "LD");
+    INSTRUCTION_DECLARE(LD_ST_V,      "Fx18", "LD");
+    INSTRUCTION_DECLARE(ADD_I_V,      "Fx1E", "ADD");
+    INSTRUCTION_DECLARE(LD_F_V,       "Fx29", "LD");
+    INSTRUCTION_DECLARE(LD_B_V,       "Fx33", "LD");
+    INSTRUCTION_DECLARE(LD_DEREF_I_V, "Fx55", "LD");
+    INSTRUCTION_DECLARE(LD_V_DEREF_I, "Fx65", "LD");
 
     #undef INSTRUCTION_DECLARE
 
     #define ASM_ONLY_INSTRUCTION_DECLARE(name, size, ins_name)                                                                     \
         class name {                                                                                                               \
             public:                                                                                                                \
-                static constexpr std::string_view NameWithTrailingSpace = ins_name " ";                                            \
-                static constexpr Address          Size                  = size;                                                    \
+                static constexpr std::string_view Mnemonic = ins_name;                                                             \
+                static constexpr Address          Size     = size;                                                                 \
                 [[nodiscard]]                                                                                                      \
                 ALWAYS_INLINE static constexpr bool Compare(const Opcode op) {                                                     \
                     UNUSED(op);                                                                                                    \
@@ -312,7 +367,7 @@ namespace tsh {
                     return out;                                                                                                    \
                 }                                                                                                                  \
                 [[nodiscard]]                                                                                                      \
-                static std::optional<std::uint8_t> Assemble(const Assembler &asmbl, const std::string_view ins);                   \
+                static std::optional<std::uint8_t> Assemble(const Assembler &asmbl, const Statement &ins);                        \
         }
 
     ASM_ONLY_INSTRUCTION_DECLARE(SPRITE, 1, ".sprite");
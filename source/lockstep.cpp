@@ -0,0 +1,319 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "lockstep.hpp"
+#include "instruction.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        template<typename T>
+        using Lanes = Lockstep::Lanes<T>;
+
+        /* All ones for every lane in the group, so results can be blended in without branching. */
+        template<typename T>
+        ALWAYS_INLINE Lanes<T> ExpandMask(const Lockstep::LaneMask group) {
+            Lanes<T> mask;
+            for (std::size_t lane = 0; lane < Lockstep::MaxLanes; lane++) {
+                mask[lane] = static_cast<T>(-static_cast<T>((group >> lane) & 1));
+            }
+
+            return mask;
+        }
+
+        /*
+            Sets every lane in the mask to the value made for it. The value is
+            made for every lane either way, so this stays a straight loop the
+            compiler can vectorize.
+        */
+        template<typename T, typename F>
+        ALWAYS_INLINE void Blend(Lanes<T> &dst, const Lanes<T> &mask, F &&make_value) {
+            for (std::size_t lane = 0; lane < Lockstep::MaxLanes; lane++) {
+                const auto value = static_cast<T>(make_value(lane));
+
+                dst[lane] = static_cast<T>((value & mask[lane]) | (dst[lane] & ~mask[lane]));
+            }
+        }
+
+        ALWAYS_INLINE RawOpcode ReadOpcode(const SharedMemory &memory, const Address address) {
+            return static_cast<RawOpcode>((std::to_integer<RawOpcode>(memory[address]) << BITSIZEOF(std::byte)) | std::to_integer<RawOpcode>(memory[address + 1]));
+        }
+
+    }
+
+    bool Lockstep::Load(const Chip8 &parent, const std::size_t count) {
+        if (count == 0 || count > MaxLanes) {
+            return false;
+        }
+
+        this->machines.clear();
+
+        for ([[maybe_unused]] const auto lane : std::views::iota(std::size_t{0}, count)) {
+            this->machines.push_back(parent.Fork());
+        }
+
+        this->running = (count == MaxLanes) ? ~LaneMask{0} : ((LaneMask{1} << count) - 1);
+
+        return true;
+    }
+
+    void Lockstep::LoadLanes() {
+        for (const auto lane : std::views::iota(std::size_t{0}, this->machines.size())) {
+            const auto &ch8 = *this->machines[lane];
+
+            for (const auto reg : std::views::iota(std::size_t{0}, this->V.size())) {
+                this->V[reg][lane] = ch8.V[reg].Get();
+            }
+
+            this->I[lane]  = ch8.I.Get();
+            this->PC[lane] = ch8.PC.Get();
+        }
+    }
+
+    void Lockstep::StoreLanes() {
+        for (const auto lane : std::views::iota(std::size_t{0}, this->machines.size())) {
+            auto &ch8 = *this->machines[lane];
+
+            for (const auto reg : std::views::iota(std::size_t{0}, this->V.size())) {
+                ch8.V[reg].Set(this->V[reg][lane]);
+            }
+
+            ch8.I.Set(this->I[lane]);
+            ch8.PC.Set(this->PC[lane]);
+        }
+    }
+
+    Lockstep::LaneMask Lockstep::Active() const {
+        LaneMask has_steps = 0;
+        for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+            has_steps |= static_cast<LaneMask>(this->steps[lane] < Chip8::InstructionsPerFrame) << lane;
+        }
+
+        return this->running & ~this->yielded & has_steps;
+    }
+
+    Lockstep::LaneMask Lockstep::Group(const LaneMask lanes, Opcode &op) const {
+        Address pc = std::numeric_limits<Address>::max();
+        for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+            const auto candidate = ((lanes >> lane) & 1) ? this->PC[lane] : std::numeric_limits<Address>::max();
+
+            pc = std::min(pc, candidate);
+        }
+
+        LaneMask group = 0;
+        for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+            group |= static_cast<LaneMask>(this->PC[lane] == pc) << lane;
+        }
+
+        group &= lanes;
+
+        const auto leader = static_cast<std::size_t>(std::countr_zero(group));
+
+        const auto &leader_memory = this->machines[leader]->memory;
+        op = Opcode(ReadOpcode(leader_memory, pc));
+
+        /* Lanes still sharing the leader's memory are running the same opcode, only the rest need reading. */
+        for (auto rest = group & (group - 1); rest != 0; rest &= rest - 1) {
+            const auto lane    = static_cast<std::size_t>(std::countr_zero(rest));
+            const auto &memory = this->machines[lane]->memory;
+
+            if (memory.Shares(leader_memory)) {
+                continue;
+            }
+
+            if (ReadOpcode(memory, pc) != op.Get()) {
+                group &= ~(LaneMask{1} << lane);
+            }
+        }
+
+        return group;
+    }
+
+    bool Lockstep::ExecuteLockstep(const Opcode op, const LaneMask group) {
+        const auto mask    = ExpandMask<std::uint8_t>(group);
+        const auto pc_mask = ExpandMask<Address>(group);
+
+        auto &Vx = this->V[op.X()];
+        auto &Vy = this->V[op.Y()];
+        auto &VF = this->V[0xF];
+
+        /* Flags are set before the result is written, same as running the instructions one machine at a time. */
+        std::array<std::uint8_t, MaxLanes> flag;
+
+        const auto next = [&](const std::size_t lane) {
+            return this->PC[lane] + sizeof(Opcode);
+        };
+
+        const auto skip_if = [&](auto &&cond) {
+            Blend(this->PC, pc_mask, [&](const std::size_t lane) {
+                return this->PC[lane] + (cond(lane) ? 2 : 1) * sizeof(Opcode);
+            });
+        };
+
+        if (JP_Addr::Compare(op)) {
+            Blend(this->PC, pc_mask, [&](const std::size_t) { return op.Addr(); });
+        } else if (JP_V0_Addr::Compare(op)) {
+            Blend(this->PC, pc_mask, [&](const std::size_t lane) { return op.Addr() + this->V[0x0][lane]; });
+        } else if (SE_V_Byte::Compare(op)) {
+            skip_if([&](const std::size_t lane) { return Vx[lane] == op.Byte(); });
+        } else if (SNE_V_Byte::Compare(op)) {
+            skip_if([&](const std::size_t lane) { return Vx[lane] != op.Byte(); });
+        } else if (SE_V_V::Compare(op)) {
+            skip_if([&](const std::size_t lane) { return Vx[lane] == Vy[lane]; });
+        } else if (SNE_V_V::Compare(op)) {
+            skip_if([&](const std::size_t lane) { return Vx[lane] != Vy[lane]; });
+        } else {
+            if (LD_V_Byte::Compare(op)) {
+                Blend(Vx, mask, [&](const std::size_t) { return op.Byte(); });
+            } else if (ADD_V_Byte::Compare(op)) {
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vx[lane] + op.Byte(); });
+            } else if (LD_V_V::Compare(op)) {
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vy[lane]; });
+            } else if (OR_V_V::Compare(op)) {
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vx[lane] | Vy[lane]; });
+            } else if (AND_V_V::Compare(op)) {
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vx[lane] & Vy[lane]; });
+            } else if (XOR_V_V::Compare(op)) {
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vx[lane] ^ Vy[lane]; });
+            } else if (ADD_V_V::Compare(op)) {
+                /* The sum is taken before the flag lands. */
+                std::array<std::uint8_t, MaxLanes> sum;
+                for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+                    const auto wide = static_cast<unsigned>(Vx[lane]) + Vy[lane];
+
+                    flag[lane] = (wide > 0xFF);
+                    sum[lane]  = static_cast<std::uint8_t>(wide);
+                }
+
+                Blend(VF, mask, [&](const std::size_t lane) { return flag[lane]; });
+                Blend(Vx, mask, [&](const std::size_t lane) { return sum[lane]; });
+            } else if (SUB_V_V::Compare(op)) {
+                for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+                    flag[lane] = (Vx[lane] > Vy[lane]);
+                }
+
+                Blend(VF, mask, [&](const std::size_t lane) { return flag[lane]; });
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vx[lane] - Vy[lane]; });
+            } else if (SUBN_V_V::Compare(op)) {
+                for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+                    flag[lane] = (Vy[lane] > Vx[lane]);
+                }
+
+                Blend(VF, mask, [&](const std::size_t lane) { return flag[lane]; });
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vy[lane] - Vx[lane]; });
+            } else if (SHR_V::Compare(op)) {
+                for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+                    flag[lane] = Vx[lane] & 1;
+                }
+
+                Blend(VF, mask, [&](const std::size_t lane) { return flag[lane]; });
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vx[lane] >> 1; });
+            } else if (SHL_V::Compare(op)) {
+                for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+                    flag[lane] = Vx[lane] >> 7;
+                }
+
+                Blend(VF, mask, [&](const std::size_t lane) { return flag[lane]; });
+                Blend(Vx, mask, [&](const std::size_t lane) { return Vx[lane] << 1; });
+            } else if (LD_I_Addr::Compare(op)) {
+                Blend(this->I, pc_mask, [&](const std::size_t) { return op.Addr(); });
+            } else {
+                return false;
+            }
+
+            Blend(this->PC, pc_mask, next);
+        }
+
+        for (std::size_t lane = 0; lane < MaxLanes; lane++) {
+            const auto in_group = static_cast<std::uint16_t>((group >> lane) & 1);
+
+            this->executed[lane] += in_group;
+            this->steps[lane]    += in_group;
+        }
+
+        return true;
+    }
+
+    void Lockstep::ExecuteScalar(const std::size_t lane) {
+        auto &ch8 = *this->machines[lane];
+
+        for (const auto reg : std::views::iota(std::size_t{0}, this->V.size())) {
+            ch8.V[reg].Set(this->V[reg][lane]);
+        }
+
+        ch8.I.Set(this->I[lane]);
+        ch8.PC.Set(this->PC[lane]);
+
+        ch8.frame_yielded = false;
+
+        const auto bit = LaneMask{1} << lane;
+
+        this->steps[lane]++;
+
+        if (!ch8.Tick()) {
+            this->running &= ~bit;
+        }
+
+        if (ch8.frame_yielded) {
+            this->yielded |= bit;
+        }
+
+        for (const auto reg : std::views::iota(std::size_t{0}, this->V.size())) {
+            this->V[reg][lane] = ch8.V[reg].Get();
+        }
+
+        this->I[lane]  = ch8.I.Get();
+        this->PC[lane] = ch8.PC.Get();
+    }
+
+    bool Lockstep::RunFrame() {
+        this->LoadLanes();
+
+        this->yielded = 0;
+        this->steps.fill(0);
+        this->executed.fill(0);
+
+        /* Lanes run independently, so the order they run in doesn't change where they end up. */
+        for (auto active = this->Active(); active != 0; active = this->Active()) {
+            Opcode op;
+            const auto group = this->Group(active, op);
+
+            if (this->ExecuteLockstep(op, group)) {
+                this->lockstep_instructions += std::popcount(group);
+                continue;
+            }
+
+            for (auto rest = group; rest != 0; rest &= rest - 1) {
+                this->ExecuteScalar(static_cast<std::size_t>(std::countr_zero(rest)));
+            }
+
+            this->scalar_instructions += std::popcount(group);
+        }
+
+        this->StoreLanes();
+
+        for (const auto lane : std::views::iota(std::size_t{0}, this->machines.size())) {
+            auto &ch8 = *this->machines[lane];
+
+            ch8.cycles += this->executed[lane];
+
+            /* Faulted machines stop before their timers, same as on their own. */
+            if ((this->running >> lane) & 1) {
+                ch8.StepTimers();
+            }
+        }
+
+        return this->running != 0;
+    }
+
+    bool Lockstep::RunHeadless(const std::size_t frames) {
+        for ([[maybe_unused]] const auto frame : std::views::iota(std::size_t{0}, frames)) {
+            if (!this->RunFrame()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
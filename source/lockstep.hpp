@@ -0,0 +1,100 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    /*
+        Many copies of one rom run side by side. Each copy's registers
+        are mirrored lane by lane, so while copies agree on where they
+        are and what they're running, simple instructions run across
+        all of them in one go. Anything else, and copies which have
+        wandered off on their own, run one at a time on their own
+        machine.
+
+        Hooks on the machines (capture, recording and so on) are not
+        run.
+    */
+    class Lockstep {
+        NON_COPYABLE(Lockstep);
+        NON_MOVEABLE(Lockstep);
+
+        public:
+            static constexpr std::size_t MaxLanes = 64;
+
+            using LaneMask = std::uint64_t;
+
+            static_assert(BITSIZEOF(LaneMask) == MaxLanes);
+
+            template<typename T>
+            using Lanes = std::array<T, MaxLanes>;
+
+            /* Every lane's machine, which owns everything that isn't mirrored below. */
+            std::vector<std::unique_ptr<Chip8>> machines;
+
+            /* Only up to date with the machines while a frame is running. */
+            std::array<Lanes<std::uint8_t>, 0x10> V = {};
+            Lanes<Address> I  = {};
+            Lanes<Address> PC = {};
+
+            /* Instructions run this frame, however they were run. */
+            Lanes<std::uint16_t> steps = {};
+
+            /* Instructions run across lanes at once this frame, added to the machines' cycles once it ends. */
+            Lanes<std::uint16_t> executed = {};
+
+            /* Lanes which haven't faulted. */
+            LaneMask running = 0;
+
+            /* Lanes which have given up the rest of the frame. */
+            LaneMask yielded = 0;
+
+            /* Instructions run across lanes at once, and instructions run lane by lane. */
+            std::uint64_t lockstep_instructions = 0;
+            std::uint64_t scalar_instructions   = 0;
+
+            ALWAYS_INLINE Lockstep() = default;
+
+            /* Every lane starts as a fork of the parent. */
+            [[nodiscard]]
+            bool Load(const Chip8 &parent, const std::size_t count);
+
+            [[nodiscard]]
+            ALWAYS_INLINE std::size_t size() const {
+                return this->machines.size();
+            }
+
+            /* Fails once every lane has faulted. */
+            [[nodiscard]]
+            bool RunFrame();
+
+            /* Stops early once every lane has faulted. */
+            bool RunHeadless(const std::size_t frames);
+
+            void LoadLanes();
+            void StoreLanes();
+
+            /* Lanes which haven't faulted, yielded or used up their instructions for the frame. */
+            [[nodiscard]]
+            LaneMask Active() const;
+
+            /*
+                The lanes out of those given which are furthest behind,
+                all sharing the same PC and opcode. Always running the
+                lanes furthest behind lets the others catch up with
+                them, so lanes which split off at a branch come back
+                together once their paths meet again.
+            */
+            [[nodiscard]]
+            LaneMask Group(const LaneMask lanes, Opcode &op) const;
+
+            /* Fails for instructions which have to be run lane by lane. */
+            [[nodiscard]]
+            bool ExecuteLockstep(const Opcode op, const LaneMask group);
+
+            void ExecuteScalar(const std::size_t lane);
+    };
+
+}
@@ -5,6 +5,14 @@
 #include "chip8.hpp"
 #include "disassemble.hpp"
 #include "assemble.hpp"
+#include "capture.hpp"
+#include "phosphor.hpp"
+#include "atlas.hpp"
+#include "movie.hpp"
+#include "archive.hpp"
+#include "rewind.hpp"
+#include "batch.hpp"
+#include "lockstep.hpp"
 
 int main(int argc, char **argv) {
     argparse::ArgumentParser program("tshipate");
@@ -17,6 +25,101 @@ int main(int argc, char **argv) {
     program.add_argument("-a", "--assemble")
         .help("Assemble the argument");
 
+    program.add_argument("-O", "--optimize")
+        .help("Rewrite assembled code to take fewer cycles")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--symbols")
+        .help("Write the labels and the source line of every address to a file when assembling");
+
+    program.add_argument("-w", "--watch")
+        .help("Keep assembling whenever the source changes")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("-l", "--list-archive")
+        .help("List the roms in a tar archive along with their hashes")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("-b", "--batch")
+        .help("Run every rom in a list file or tar archive headless and report how each ended up")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--cycles")
+        .help("Stop each batch rom after this many instructions")
+        .default_value(std::numeric_limits<std::uint64_t>::max())
+        .action([](const std::string &value) { return static_cast<std::uint64_t>(std::stoull(value)); });
+
+    program.add_argument("-j", "--jobs")
+        .help("Threads to run batch roms or assemble on, or 0 for one per core. Assembly only uses threads when given")
+        .default_value(std::size_t{0})
+        .action([](const std::string &value) { return static_cast<std::size_t>(std::stoull(value)); });
+
+    program.add_argument("-c", "--capture")
+        .help("Stream presented frames to a file, or '-' for stdout, moving other output to stderr");
+
+    program.add_argument("--capture-format")
+        .help("Format of captured frames: raw, y4m or ppm")
+        .default_value(std::string("y4m"));
+
+    program.add_argument("-p", "--phosphor")
+        .help("Blend frames together to reduce flicker")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("-n", "--instances")
+        .help("Run this many copies of the rom, all shown in one window")
+        .default_value(std::size_t{1})
+        .action([](const std::string &value) { return static_cast<std::size_t>(std::stoull(value)); });
+
+    program.add_argument("--lockstep")
+        .help("Run the copies of the rom headless in lockstep and report how each ended up")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("-k", "--keymap")
+        .help("Remap profile for the keyboard");
+
+    program.add_argument("--headless")
+        .help("Run without a window, as fast as possible")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("-f", "--frames")
+        .help("Number of frames to run for when headless")
+        .default_value(std::size_t{600})
+        .action([](const std::string &value) { return static_cast<std::size_t>(std::stoull(value)); });
+
+    program.add_argument("-s", "--seed")
+        .help("Seed for the random number generator")
+        .action([](const std::string &value) { return static_cast<std::uint64_t>(std::stoull(value, nullptr, 0)); });
+
+    program.add_argument("--record")
+        .help("Record the input of every frame to a movie file");
+
+    program.add_argument("--replay")
+        .help("Replay the input of a movie file instead of reading the keyboard");
+
+    program.add_argument("--rewind")
+        .help("Keep snapshots to wind back through by holding backspace")
+        .default_value(false)
+        .implicit_value(true);
+
+    program.add_argument("--load-state")
+        .help("Restore the machine from a save state before running");
+
+    program.add_argument("--save-state")
+        .help("Write a save state of the machine once it stops running");
+
+    program.add_argument("--hash-log")
+        .help("Write the hash of every presented frame to a file");
+
+    program.add_argument("--hash-check")
+        .help("Compare the hash of every presented frame against a file written by --hash-log");
+
     program.add_argument("rom_path")
         .help("The rom to act on");
 
@@ -27,6 +130,55 @@ int main(int argc, char **argv) {
         const auto to_assemble = program.get<std::string>("--assemble");
 
         tsh::Assembler assembler;
+        assembler.optimize = program.get<bool>("--optimize");
+
+        /* Assembling stays on this thread unless threads are asked for. */
+        if (program.is_used("--jobs")) {
+            assembler.jobs = program.get<std::size_t>("--jobs");
+        }
+
+        const auto symbols_path = program.present("--symbols");
+
+        if (program.get<bool>("--watch")) {
+            static constexpr auto PollInterval = std::chrono::milliseconds(100);
+
+            std::optional<std::filesystem::file_time_type> last_write;
+
+            while (true) {
+                std::error_code error;
+                const auto write_time = std::filesystem::last_write_time(to_assemble, error);
+
+                if (error || write_time == last_write) {
+                    std::this_thread::sleep_for(PollInterval);
+                    continue;
+                }
+
+                last_write = write_time;
+
+                const auto start = std::chrono::steady_clock::now();
+
+                const auto data = assembler.ReassembleFromFile(to_assemble);
+                if (!data.has_value()) {
+                    std::printf("Failed to assemble program!\n");
+                    continue;
+                }
+
+                if (!tsh::util::WriteToFile(rom_path, *data)) {
+                    std::printf("Failed to write program to file!\n");
+                    continue;
+                }
+
+                if (symbols_path.has_value() && !assembler.WriteSymbols(*symbols_path, to_assemble)) {
+                    std::printf("Failed to write symbols to file!\n");
+                }
+
+                const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+                std::printf("Encoded %zu of %zu statements in %.2fms\n", assembler.reencoded, assembler.layout.statements.size(), elapsed.count());
+                std::fflush(stdout);
+            }
+        }
+
         const auto data = assembler.AssembleFromFile(to_assemble);
         if (!data.has_value()) {
             std::printf("Failed to assemble program!\n");
@@ -36,6 +188,20 @@ int main(int argc, char **argv) {
         if (!tsh::util::WriteToFile(rom_path, std::span(*data))) {
             std::printf("Failed to write program to file!\n");
         }
+
+        if (symbols_path.has_value() && !assembler.WriteSymbols(*symbols_path, to_assemble)) {
+            std::printf("Failed to write symbols to file!\n");
+        }
+    } else if (program.get<bool>("--list-archive")) {
+        tsh::RomArchive archive;
+        if (!archive.Open(rom_path)) {
+            std::printf("Failed to open archive!\n");
+            return 1;
+        }
+
+        for (const auto &entry : archive) {
+            fmt::print("{:016x} {:5} {}\n", entry.hash, entry.data.size(), entry.name);
+        }
     } else if (program.get<bool>("--disassemble")) {
         tsh::Disassembler dis;
         const auto str = dis.Disassemble(rom_path);
@@ -45,6 +211,101 @@ int main(int argc, char **argv) {
         }
 
         std::printf(str->c_str());
+    } else if (program.get<bool>("--batch")) {
+        const auto seed = program.is_used("--seed") ? program.get<std::uint64_t>("--seed") : 0;
+
+        tsh::BatchRunner runner(program.get<std::size_t>("--frames"), program.get<std::uint64_t>("--cycles"), seed);
+
+        tsh::RomArchive archive;
+
+        if (rom_path.ends_with(".tar")) {
+            if (!archive.Open(rom_path)) {
+                std::printf("Failed to open archive!\n");
+                return 1;
+            }
+
+            runner.AddArchive(archive);
+        } else if (!runner.AddList(rom_path)) {
+            std::printf("Failed to read rom list!\n");
+            return 1;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        tsh::util::ThreadPool pool(program.get<std::size_t>("--jobs"));
+        runner.Run(pool);
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+        runner.Print();
+
+        std::fprintf(stderr, "Ran %zu roms on %zu threads in %.2fs\n", runner.jobs.size(), pool.size(), elapsed.count());
+    } else if (program.get<bool>("--lockstep")) {
+        tsh::Chip8 parent;
+        if (!parent.LoadProgram(rom_path)) {
+            std::printf("Failed to load program!\n");
+            return 1;
+        }
+
+        const auto instances = program.get<std::size_t>("--instances");
+        const auto frames    = program.get<std::size_t>("--frames");
+        const auto seed      = program.is_used("--seed") ? program.get<std::uint64_t>("--seed") : 0;
+
+        std::vector<std::unique_ptr<tsh::Lockstep>> groups;
+        for (std::size_t first = 0; first < instances; first += tsh::Lockstep::MaxLanes) {
+            auto &group = groups.emplace_back(std::make_unique<tsh::Lockstep>());
+            if (!group->Load(parent, std::min(tsh::Lockstep::MaxLanes, instances - first))) {
+                std::printf("Failed to set up lanes!\n");
+                return 1;
+            }
+
+            /* Consecutive seeds, so each copy sees different random numbers. */
+            for (const auto &[lane, ch8] : group->machines | tsh::util::enumerate) {
+                ch8->rng.Seed(seed + first + lane);
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        tsh::util::ThreadPool pool(program.get<std::size_t>("--jobs"));
+        for (auto &group : groups) {
+            pool.Submit([&group, frames]() {
+                group->RunHeadless(frames);
+            });
+        }
+
+        pool.Wait();
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+        std::uint64_t lockstep_instructions = 0;
+        std::uint64_t scalar_instructions   = 0;
+
+        std::size_t index = 0;
+        for (const auto &group : groups) {
+            for (const auto &ch8 : group->machines) {
+                const auto status = (ch8->fault == tsh::Chip8::FaultKind::None) ? std::string("ok") : fmt::format("{} {:04X} at {:04X}", tsh::Chip8::FaultNames[ch8->fault], ch8->fault_opcode, ch8->fault_address);
+
+                fmt::print("{:016x} {:>12} {:<32} {}\n", ch8->display.Hash(), ch8->cycles, status, index);
+
+                index++;
+            }
+
+            lockstep_instructions += group->lockstep_instructions;
+            scalar_instructions   += group->scalar_instructions;
+        }
+
+        const auto total = std::max<std::uint64_t>(lockstep_instructions + scalar_instructions, 1);
+        std::fprintf(stderr, "Ran %zu copies for %zu frames in %.2fs, %.1f%% of instructions in lockstep\n", instances, frames, elapsed.count(), 100.0 * static_cast<double>(lockstep_instructions) / static_cast<double>(total));
+    } else if (const auto instances = program.get<std::size_t>("--instances"); instances > 1) {
+        tsh::InstanceGroup group;
+        if (!group.Load(rom_path, instances)) {
+            std::printf("Failed to load program!\n");
+            return 1;
+        }
+
+        tsh::AtlasView atlas(instances);
+        atlas.Loop(group);
     } else {
         tsh::Chip8 ch8;
         if (!ch8.LoadProgram(rom_path)) {
@@ -52,7 +313,140 @@ int main(int argc, char **argv) {
             return 1;
         }
 
-        ch8.Loop();
+        if (program.present("--keymap")) {
+            if (!ch8.keyboard.LoadProfile(program.get<std::string>("--keymap"))) {
+                std::printf("Failed to load keymap!\n");
+                return 1;
+            }
+        }
+
+        const auto capture_format = tsh::FrameCapture::FormatNames[program.get<std::string>("--capture-format")];
+        if (!capture_format.has_value()) {
+            std::printf("Unknown capture format!\n");
+            return 1;
+        }
+
+        tsh::FrameCapture capture(*capture_format);
+
+        if (program.present("--capture")) {
+            if (!capture.Open(program.get<std::string>("--capture"))) {
+                std::printf("Failed to open capture output!\n");
+                return 1;
+            }
+
+            ch8.capture = &capture;
+        }
+
+        tsh::InputMovie replay_movie;
+        tsh::MoviePlayer player(replay_movie);
+
+        if (program.present("--replay")) {
+            if (!replay_movie.Load(program.get<std::string>("--replay"))) {
+                std::printf("Failed to load movie!\n");
+                return 1;
+            }
+
+            ch8.rng.Seed(replay_movie.seed);
+            ch8.replay = &player;
+        } else if (program.is_used("--seed")) {
+            ch8.rng.Seed(program.get<std::uint64_t>("--seed"));
+        }
+
+        if (program.present("--load-state")) {
+            const auto state = tsh::util::ReadFromFile(program.get<std::string>("--load-state"));
+            if (!state.has_value() || !ch8.LoadState(*state)) {
+                std::printf("Failed to load save state!\n");
+                return 1;
+            }
+        }
+
+        tsh::InputMovie recording;
+
+        if (program.present("--record")) {
+            recording.seed = ch8.rng.state;
+            ch8.recording  = &recording;
+        }
+
+        /* Only made when asked for, since it needs a GL context. */
+        std::optional<tsh::Phosphor> phosphor;
+
+        if (program.get<bool>("--phosphor")) {
+            ch8.phosphor = &phosphor.emplace();
+        }
+
+        tsh::Rewind rewind;
+
+        if (program.get<bool>("--rewind")) {
+            /* Winding back would leave the movie out of step with the machine. */
+            if (ch8.recording != nullptr || ch8.replay != nullptr) {
+                std::printf("Can't rewind while recording or replaying!\n");
+                return 1;
+            }
+
+            ch8.rewind = &rewind;
+        }
+
+        std::vector<std::uint64_t> frame_hashes;
+
+        if (program.present("--hash-log") || program.present("--hash-check")) {
+            ch8.frame_hashes = &frame_hashes;
+        }
+
+        if (program.get<bool>("--headless")) {
+            /* A replay runs for as long as the movie unless told otherwise. */
+            const auto frames = (ch8.replay != nullptr && !program.is_used("--frames")) ? replay_movie.FrameCount() : program.get<std::size_t>("--frames");
+
+            frame_hashes.reserve(frames);
+
+            if (!ch8.RunHeadless(frames)) {
+                ch8.PrintFault();
+                std::printf("Program stopped after %zu frames!\n", frame_hashes.size());
+            }
+        } else {
+            ch8.Loop();
+        }
+
+        capture.Close();
+
+        if (ch8.capture != nullptr) {
+            std::fprintf(stderr, "Captured %zu frames, dropped %zu\n", capture.written_frames, capture.dropped_frames.load());
+        }
+
+        if (program.present("--save-state")) {
+            std::array<std::byte, tsh::Chip8::StateSize> state;
+            if (!ch8.SaveState(state) || !tsh::util::WriteToFile(program.get<std::string>("--save-state"), state)) {
+                std::printf("Failed to write save state!\n");
+                return 1;
+            }
+        }
+
+        if (program.present("--record")) {
+            if (!recording.Save(program.get<std::string>("--record"))) {
+                std::printf("Failed to write movie!\n");
+                return 1;
+            }
+        }
+
+        if (program.present("--hash-log")) {
+            if (!tsh::util::WriteHashList(program.get<std::string>("--hash-log"), frame_hashes)) {
+                std::printf("Failed to write hash log!\n");
+                return 1;
+            }
+        }
+
+        if (program.present("--hash-check")) {
+            const auto golden = tsh::util::ReadHashList(program.get<std::string>("--hash-check"));
+            if (!golden.has_value()) {
+                std::printf("Failed to read hash list!\n");
+                return 1;
+            }
+
+            const auto [frame_it, golden_it] = std::ranges::mismatch(frame_hashes, *golden);
+            if (frame_it != frame_hashes.end() || golden_it != golden->end()) {
+                std::printf("Frame hashes diverge at frame %zu!\n", static_cast<std::size_t>(frame_it - frame_hashes.begin()));
+                return 1;
+            }
+        }
     }
 
     return 0;
@@ -0,0 +1,124 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "movie.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        /* Magic, version, padding, seed and run count. */
+        constexpr std::size_t HeaderSize = sizeof(std::uint32_t) + 2 * sizeof(std::uint16_t) + sizeof(std::uint64_t) + sizeof(std::uint64_t);
+
+        /* Key mask, current key and the longest possible varint. */
+        constexpr std::size_t MaxRunSize = sizeof(Keyboard::KeyMask) + sizeof(Key) + 10;
+
+    }
+
+    std::uint64_t InputMovie::FrameCount() const {
+        std::uint64_t frames = 0;
+        for (const auto &run : this->runs) {
+            frames += run.frames;
+        }
+
+        return frames;
+    }
+
+    void InputMovie::Record(const Keyboard &keyboard) {
+        const auto input = FrameInput{keyboard.pressed_keys, keyboard.current_key};
+
+        if (!this->runs.empty() && this->runs.back().input == input) {
+            this->runs.back().frames++;
+            return;
+        }
+
+        this->runs.push_back(Run{input, 1});
+    }
+
+    bool InputMovie::Save(const std::string &path) const {
+        auto data = std::vector<std::byte>(HeaderSize + this->runs.size() * MaxRunSize);
+
+        auto writer = util::ByteWriter(data);
+
+        writer.Write(Magic);
+        writer.Write(Version);
+        writer.Write(std::uint16_t{0});
+        writer.Write(this->seed);
+        writer.Write(static_cast<std::uint64_t>(this->runs.size()));
+
+        for (const auto &run : this->runs) {
+            writer.Write(run.input.pressed_keys);
+            writer.Write(static_cast<std::uint8_t>(run.input.current_key));
+            writer.WriteVarint(run.frames);
+        }
+
+        if (!writer.Ok()) {
+            return false;
+        }
+
+        return util::WriteToFile(path, std::span(data.data(), writer.offset));
+    }
+
+    bool InputMovie::Load(const std::string &path) {
+        const auto data = util::ReadFromFile(path);
+        if (!data.has_value()) {
+            return false;
+        }
+
+        auto reader = util::ByteReader(*data);
+
+        if (reader.Read<std::uint32_t>() != Magic || reader.Read<std::uint16_t>() != Version) {
+            return false;
+        }
+
+        /* Padding. */
+        reader.Skip(sizeof(std::uint16_t));
+
+        this->seed = reader.Read<std::uint64_t>();
+
+        const auto run_count = reader.Read<std::uint64_t>();
+        if (!reader.Ok()) {
+            return false;
+        }
+
+        this->runs.clear();
+
+        for ([[maybe_unused]] const auto i : std::views::iota(std::uint64_t{0}, run_count)) {
+            Run run;
+
+            run.input.pressed_keys = reader.Read<Keyboard::KeyMask>();
+            run.input.current_key  = static_cast<Key>(reader.Read<std::uint8_t>());
+            run.frames             = reader.ReadVarint();
+
+            if (!reader.Ok() || run.input.current_key > Key::Invalid) {
+                return false;
+            }
+
+            this->runs.push_back(run);
+        }
+
+        return reader.AtEnd();
+    }
+
+    void MoviePlayer::Play(Keyboard &keyboard) {
+        /* Skip over any empty runs, which we never write but could be handed. */
+        while (!this->Finished() && this->frame_in_run >= this->movie.runs[this->run_index].frames) {
+            this->run_index++;
+            this->frame_in_run = 0;
+        }
+
+        if (this->Finished()) {
+            keyboard.pressed_keys = 0;
+            keyboard.current_key  = Key::Invalid;
+
+            return;
+        }
+
+        const auto &input = this->movie.runs[this->run_index].input;
+
+        keyboard.pressed_keys = input.pressed_keys;
+        keyboard.current_key  = input.current_key;
+
+        this->frame_in_run++;
+    }
+
+}
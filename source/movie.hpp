@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    /*
+        The keyboard state at the start of every frame, plus the
+        seed the machine was started with. Consecutive identical
+        frames are stored as a single run.
+    */
+    class InputMovie {
+        NON_COPYABLE(InputMovie);
+        NON_MOVEABLE(InputMovie);
+
+        public:
+            static constexpr std::uint32_t Magic   = 0x4D485354; /* "TSHM" */
+            static constexpr std::uint16_t Version = 1;
+
+            struct FrameInput {
+                Keyboard::KeyMask pressed_keys = 0;
+
+                /* The key waiting to be picked up by LD Vx, K. */
+                Key current_key = Key::Invalid;
+
+                constexpr bool operator ==(const FrameInput &) const = default;
+            };
+
+            struct Run {
+                FrameInput input;
+                std::uint64_t frames;
+            };
+
+            std::uint64_t seed = 0;
+            std::vector<Run> runs;
+
+            ALWAYS_INLINE InputMovie() = default;
+
+            [[nodiscard]]
+            std::uint64_t FrameCount() const;
+
+            void Record(const Keyboard &keyboard);
+
+            [[nodiscard]]
+            bool Save(const std::string &path) const;
+
+            [[nodiscard]]
+            bool Load(const std::string &path);
+    };
+
+    /* Feeds a movie back into a keyboard, one frame at a time. */
+    class MoviePlayer {
+        NON_COPYABLE(MoviePlayer);
+        NON_MOVEABLE(MoviePlayer);
+
+        public:
+            const InputMovie &movie;
+
+            std::size_t run_index = 0;
+            std::uint64_t frame_in_run = 0;
+
+            ALWAYS_INLINE explicit MoviePlayer(const InputMovie &movie) : movie(movie) { }
+
+            [[nodiscard]]
+            ALWAYS_INLINE bool Finished() const {
+                return this->run_index >= this->movie.runs.size();
+            }
+
+            /* Once the movie is over, every key stays released. */
+            void Play(Keyboard &keyboard);
+    };
+
+}
@@ -0,0 +1,192 @@
+#include "common.hpp"
+#include "assemble.hpp"
+#include "peephole.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        /* Operand text for every byte, so merged immediates need nowhere to live. */
+        constexpr auto ByteOperands = []() {
+            constexpr std::string_view Digits = "0123456789ABCDEF";
+
+            std::array<std::array<char, 4>, 0x100> operands = {};
+            for (const auto i : std::views::iota(std::size_t{0}, operands.size())) {
+                operands[i] = {'0', 'x', Digits[i >> 4], Digits[i & 0xF]};
+            }
+
+            return operands;
+        }();
+
+        ALWAYS_INLINE constexpr std::string_view ByteOperand(const std::uint8_t byte) {
+            return std::string_view(ByteOperands[byte].data(), ByteOperands[byte].size());
+        }
+
+        static_assert(Assembler::ToNumber<std::uint8_t>(ByteOperand(0xA5)) == 0xA5);
+
+        bool IsSkip(const Statement &statement) {
+            return statement.mnemonic == "SE" || statement.mnemonic == "SNE" || statement.mnemonic == "SKP" || statement.mnemonic == "SKNP";
+        }
+
+        bool IsSelfLoad(const Statement &statement) {
+            const auto captures = statement.Match("LD", "V*", "V*");
+            if (!captures.has_value()) {
+                return false;
+            }
+
+            return Assembler::RegisterNibble((*captures)[0]).has_value() && (*captures)[0] == (*captures)[1];
+        }
+
+        /* The register and byte of an ADD Vx, byte. */
+        std::optional<std::pair<std::uint8_t, std::uint8_t>> AddByte(const Statement &statement) {
+            const auto captures = statement.Match("ADD", "V*", "*");
+            if (!captures.has_value()) {
+                return {};
+            }
+
+            const auto reg  = Assembler::RegisterNibble((*captures)[0]);
+            const auto byte = Assembler::ToNumber<std::uint8_t>((*captures)[1]);
+            if (!reg.has_value() || !byte.has_value()) {
+                return {};
+            }
+
+            return std::pair(*reg, *byte);
+        }
+
+        /* The address operand of a JP, CALL or LD I. */
+        constexpr std::optional<std::string_view> AddressOperand(const Statement &statement) {
+            for (const auto captures : {statement.Match("JP", "*"), statement.Match("CALL", "*"), statement.Match("LD", "I", "*")}) {
+                if (captures.has_value()) {
+                    return (*captures)[0];
+                }
+            }
+
+            return {};
+        }
+
+        /*
+            Whether statements can be dropped without moving anything a
+            program still refers to. Numbers and label arithmetic point at
+            where code used to be, and JP V0 jump tables count on their size.
+        */
+        constexpr bool CanResize(const std::span<const Statement> statements) {
+            std::vector<std::string_view> labels;
+            for (const auto &statement : statements) {
+                if (statement.IsLabel()) {
+                    labels.push_back(statement.Label());
+                }
+            }
+
+            std::ranges::sort(labels);
+
+            return std::ranges::all_of(statements, [&](const Statement &statement) {
+                if (statement.Match("JP", "V0", "*").has_value()) {
+                    return false;
+                }
+
+                const auto address = AddressOperand(statement);
+
+                return !address.has_value() || std::ranges::binary_search(labels, *address);
+            });
+        }
+
+        static_assert(CanResize(std::array{*Statement::Lex("loop:"), *Statement::Lex("CALL loop"), *Statement::Lex("JP loop")}));
+        static_assert(!CanResize(std::array{*Statement::Lex("loop:"), *Statement::Lex("JP 0x20A")}));
+        static_assert(!CanResize(std::array{*Statement::Lex("loop:"), *Statement::Lex("CALL 0x300")}));
+        static_assert(!CanResize(std::array{*Statement::Lex("loop:"), *Statement::Lex("LD I, 0x2F0")}));
+        static_assert(!CanResize(std::array{*Statement::Lex("start:"), *Statement::Lex("LD I, start+6")}));
+        static_assert(!CanResize(std::array{*Statement::Lex("table:"), *Statement::Lex("JP V0, table")}));
+
+    }
+
+    std::size_t Peephole::Optimize(std::vector<Statement> &statements, std::vector<std::string_view> &lines) {
+        std::size_t rewritten = 0;
+
+        if (CanResize(statements)) {
+            /* The last two instructions kept, looking past labels. */
+            std::optional<std::size_t> last;
+            std::optional<std::size_t> before_last;
+
+            /* Whether something could jump in between the last instruction kept and this one. */
+            bool label_since_last = false;
+
+            std::size_t kept = 0;
+
+            for (const auto i : std::views::iota(std::size_t{0}, statements.size())) {
+                const auto statement = statements[i];
+                const auto line      = lines[i];
+
+                if (!statement.IsLabel()) {
+                    const auto after_skip = last.has_value() && IsSkip(statements[*last]);
+
+                    if (!after_skip && IsSelfLoad(statement)) {
+                        rewritten++;
+                        continue;
+                    }
+
+                    const auto add = AddByte(statement);
+                    if (add.has_value() && last.has_value() && !label_since_last && !(before_last.has_value() && IsSkip(statements[*before_last]))) {
+                        const auto previous_add = AddByte(statements[*last]);
+
+                        /* ADD Vx, byte leaves VF alone, so wrapping sums are exact. */
+                        if (previous_add.has_value() && previous_add->first == add->first) {
+                            statements[*last].operands[1] = ByteOperand(previous_add->second + add->second);
+
+                            rewritten++;
+                            continue;
+                        }
+                    }
+
+                    before_last = last;
+                    last        = kept;
+
+                    label_since_last = false;
+                } else {
+                    label_since_last = true;
+                }
+
+                statements[kept] = statement;
+                lines[kept]      = line;
+
+                kept++;
+            }
+
+            statements.resize(kept);
+            lines.resize(kept);
+        }
+
+        /* Where each label lands. */
+        std::unordered_map<std::string_view, std::size_t> targets;
+
+        std::optional<std::size_t> next;
+        for (const auto i : std::views::iota(std::size_t{0}, statements.size()) | std::views::reverse) {
+            if (!statements[i].IsLabel()) {
+                next = i;
+                continue;
+            }
+
+            if (next.has_value()) {
+                targets.try_emplace(statements[i].Label(), *next);
+            }
+        }
+
+        for (auto &statement : statements) {
+            const auto captures = statement.Match("JP", "*");
+            if (!captures.has_value()) {
+                continue;
+            }
+
+            const auto target = targets.find((*captures)[0]);
+            if (target == targets.end() || !statements[target->second].Match("RET").has_value()) {
+                continue;
+            }
+
+            statement = statements[target->second];
+
+            rewritten++;
+        }
+
+        return rewritten;
+    }
+
+}
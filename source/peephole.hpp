@@ -0,0 +1,27 @@
+#pragma once
+
+#include "common.hpp"
+#include "statement.hpp"
+
+namespace tsh {
+
+    /*
+        Rewrites expanded statements into ones which take fewer cycles,
+        before any addresses are handed out:
+
+            LD Vx, Vx              is dropped.
+            ADD Vx, a; ADD Vx, b   becomes ADD Vx, a + b.
+            JP to a RET            becomes RET.
+
+        Nothing is dropped or merged right after a skip, since the skip
+        would then land somewhere else. Programs using JP V0, or giving
+        JP, CALL or LD I anything but a label, are left at their original
+        size, as they depend on where code sits.
+    */
+    class Peephole {
+        public:
+            /* Gives back how many statements were dropped or rewritten. */
+            static std::size_t Optimize(std::vector<Statement> &statements, std::vector<std::string_view> &lines);
+    };
+
+}
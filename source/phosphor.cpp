@@ -0,0 +1,117 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "phosphor.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        using IntensityChunk = Phosphor::IntensityChunk;
+        using WideChunk      = Phosphor::WideChunk;
+
+        static_assert(Phosphor::ChunkWidth == 2 * BITSIZEOF(std::byte));
+
+        /* For each pixel of a chunk, which bit of its byte it is. */
+        constexpr IntensityChunk BitMasks = {
+            0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+            0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+        };
+
+        /* Expands a chunk of a bitmap row into 0xFF for lit pixels and 0x00 for dark ones. */
+        ALWAYS_INLINE IntensityChunk LitMask(const Display::RowType row, const std::size_t chunk) {
+            const auto shift = BITSIZEOF(Display::RowType) - (chunk + 1) * Phosphor::ChunkWidth;
+            const auto bits  = static_cast<std::uint16_t>(row >> shift);
+
+            const auto hi = static_cast<std::uint8_t>(bits >> 8);
+            const auto lo = static_cast<std::uint8_t>(bits & 0xFF);
+
+            const IntensityChunk spread = {
+                hi, hi, hi, hi, hi, hi, hi, hi,
+                lo, lo, lo, lo, lo, lo, lo, lo,
+            };
+
+            return reinterpret_cast<IntensityChunk>((spread & BitMasks) != 0);
+        }
+
+    }
+
+    void Phosphor::Update(const Display::Buffer &buffer) {
+        std::uint32_t changed_rows = 0;
+        for (const auto y : std::views::iota(Display::Coord{0}, Height)) {
+            if (buffer[y] != this->last_buffer[y]) {
+                changed_rows |= (std::uint32_t{1} << y);
+            }
+        }
+
+        /* Rows which are neither changing nor fading are already settled. */
+        auto to_update = changed_rows | this->fading_rows;
+
+        this->dirty_rows |= to_update;
+        this->fading_rows = 0;
+
+        while (to_update != 0) {
+            const auto y = std::countr_zero(to_update);
+            to_update &= to_update - 1;
+
+            IntensityChunk still_fading = {};
+
+            for (const auto &&[chunk_index, chunk] : util::enumerate(this->intensity[y])) {
+                const auto lit = LitMask(buffer[y], chunk_index);
+
+                const auto decayed = __builtin_convertvector(
+                    (__builtin_convertvector(chunk, WideChunk) * this->decay) >> 8,
+                    IntensityChunk
+                );
+
+                const auto faded = decayed & ~lit;
+
+                chunk         = lit | faded;
+                still_fading |= faded;
+            }
+
+            /* Any dark pixel with intensity left needs revisiting next frame. */
+            std::array<std::uint64_t, sizeof(IntensityChunk) / sizeof(std::uint64_t)> fading_words;
+            std::memcpy(fading_words.data(), &still_fading, sizeof(still_fading));
+
+            if (std::ranges::any_of(fading_words, [](const std::uint64_t word) { return word != 0; })) {
+                this->fading_rows |= (std::uint32_t{1} << y);
+            }
+
+            this->last_buffer[y] = buffer[y];
+        }
+    }
+
+    bool Phosphor::Render(sf::RenderWindow &window) {
+        if (this->dirty_rows != 0) {
+            const auto first = std::countr_zero(this->dirty_rows);
+            const auto last  = BITSIZEOF(this->dirty_rows) - std::countl_zero(this->dirty_rows);
+
+            for (const auto y : std::views::iota(first, static_cast<int>(last))) {
+                for (const auto x : std::views::iota(std::size_t{0}, std::size_t{Width})) {
+                    const auto value = this->intensity[y][x / ChunkWidth][x % ChunkWidth];
+                    const auto pixel = this->pixels.data() + (y * Width + x) * 4;
+
+                    pixel[0] = value;
+                    pixel[1] = value;
+                    pixel[2] = value;
+                    pixel[3] = FullIntensity;
+                }
+            }
+
+            /* Only upload the band of rows which actually changed. */
+            this->texture.update(this->pixels.data() + first * Width * 4, Width, last - first, 0, first);
+
+            this->dirty_rows = 0;
+        }
+
+        auto sprite = sf::Sprite(this->texture);
+        sprite.setScale(Display::PixelWidth, Display::PixelWidth);
+
+        window.clear();
+        window.draw(sprite);
+        window.display();
+
+        return true;
+    }
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    /*
+        Keeps a per-pixel intensity which snaps to full when a
+        pixel is lit and decays each frame after it goes dark,
+        hiding the flicker of sprites being erased and redrawn.
+    */
+    class Phosphor {
+        NON_COPYABLE(Phosphor);
+        NON_MOVEABLE(Phosphor);
+
+        public:
+            static constexpr auto Width  = Display::DisplayWidth;
+            static constexpr auto Height = Display::DisplayHeight;
+
+            using Intensity = std::uint8_t;
+
+            static constexpr std::size_t ChunkWidth   = 16;
+            static constexpr std::size_t ChunksPerRow = Width / ChunkWidth;
+
+            /* A run of intensities processed as a single vector. */
+            using IntensityChunk = Intensity __attribute__((vector_size(ChunkWidth)));
+
+            /* Wide enough to hold an intensity multiplied by the decay. */
+            using WideChunk = std::uint16_t __attribute__((vector_size(ChunkWidth * sizeof(std::uint16_t))));
+
+            using IntensityRow = std::array<IntensityChunk, ChunksPerRow>;
+
+            static constexpr Intensity FullIntensity = std::numeric_limits<Intensity>::max();
+
+            /* Fraction of intensity, out of 256, kept each frame. */
+            static constexpr std::uint16_t DefaultDecay = 192;
+
+            static_assert(BITSIZEOF(Display::RowType) == Width);
+
+            std::uint16_t decay = DefaultDecay;
+
+            std::array<IntensityRow, Height> intensity = {};
+
+            /* The bitmap the intensities were last updated against. */
+            std::array<Display::RowType, Height> last_buffer = {};
+
+            /* Rows with pixels which haven't finished fading out. */
+            std::uint32_t fading_rows = 0;
+
+            /* Rows whose intensities changed since the last upload. Starts as every row, since a new texture holds garbage. */
+            std::uint32_t dirty_rows = ~std::uint32_t{0} >> (BITSIZEOF(std::uint32_t) - Height);
+
+            static_assert(BITSIZEOF(fading_rows) >= Height);
+
+            std::array<sf::Uint8, Width * Height * 4> pixels = {};
+
+            sf::Texture texture;
+
+            ALWAYS_INLINE Phosphor() {
+                this->texture.create(Width, Height);
+            }
+
+            void Update(const Display::Buffer &buffer);
+
+            bool Render(sf::RenderWindow &window);
+    };
+
+}
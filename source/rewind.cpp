@@ -0,0 +1,182 @@
+#include "common.hpp"
+#include "util.hpp"
+#include "rewind.hpp"
+
+namespace tsh {
+
+    namespace {
+
+        /* Shorter runs of zeroes cost more to encode than to copy. */
+        constexpr std::size_t MinZeroRun = 4;
+
+        void AppendVarint(std::vector<std::byte> &out, std::uint64_t value) {
+            do {
+                auto byte = static_cast<std::uint8_t>(value & 0x7F);
+                value >>= 7;
+
+                if (value != 0) {
+                    byte |= 0x80;
+                }
+
+                out.push_back(static_cast<std::byte>(byte));
+            } while (value != 0);
+        }
+
+    }
+
+    Rewind::Rewind(const std::size_t interval, const std::size_t capacity, const std::size_t byte_budget)
+        : interval(std::max<std::size_t>(interval, 1)), byte_budget(byte_budget), deltas(std::max<std::size_t>(capacity, 1)) { }
+
+    void Rewind::CompressDelta(std::vector<std::byte> &out, const State &older, const State &newer) {
+        out.clear();
+
+        const auto differs = [&](const std::size_t i) {
+            return older[i] != newer[i];
+        };
+
+        /* Alternating runs: how many bytes are unchanged, then how many changed and what to XOR them with. */
+        std::size_t i = 0;
+        while (i < older.size()) {
+            const auto zero_start = i;
+            while (i < older.size() && !differs(i)) {
+                i++;
+            }
+
+            const auto literal_start = i;
+            while (i < older.size()) {
+                if (differs(i)) {
+                    i++;
+                    continue;
+                }
+
+                /* Only end the literal for a run of zeroes worth skipping. */
+                auto zero_end = i;
+                while (zero_end < older.size() && zero_end - i < MinZeroRun && !differs(zero_end)) {
+                    zero_end++;
+                }
+
+                if (zero_end - i == MinZeroRun || zero_end == older.size()) {
+                    break;
+                }
+
+                i = zero_end;
+            }
+
+            AppendVarint(out, literal_start - zero_start);
+            AppendVarint(out, i - literal_start);
+
+            for (const auto j : std::views::iota(literal_start, i)) {
+                out.push_back(older[j] ^ newer[j]);
+            }
+        }
+    }
+
+    void Rewind::ApplyDelta(State &state, const std::span<const std::byte> delta) {
+        auto reader = util::ByteReader(delta);
+
+        std::size_t i = 0;
+        while (reader.Ok() && !reader.AtEnd()) {
+            i += reader.ReadVarint();
+
+            const auto literal_size = reader.ReadVarint();
+            if (!reader.Ok() || i > state.size() || state.size() - i < literal_size || delta.size() - reader.offset < literal_size) {
+                return;
+            }
+
+            for (const auto &byte : delta.subspan(reader.offset, literal_size)) {
+                state[i] ^= byte;
+                i++;
+            }
+
+            reader.Skip(literal_size);
+        }
+    }
+
+    void Rewind::Release(std::vector<std::byte> &slot) {
+        this->bytes -= slot.capacity();
+
+        /* Clearing alone would keep the storage. */
+        slot = std::vector<std::byte>();
+    }
+
+    void Rewind::DropOldest() {
+        if (this->count == 0) {
+            return;
+        }
+
+        this->Release(this->deltas[this->head]);
+
+        this->head = (this->head + 1) % this->deltas.size();
+        this->count--;
+    }
+
+    void Rewind::OnFrame(const Chip8 &ch8) {
+        this->at_newest = false;
+
+        if (this->frames_until_snapshot > 0) {
+            this->frames_until_snapshot--;
+            return;
+        }
+
+        this->frames_until_snapshot = this->interval - 1;
+
+        State state;
+        if (!ch8.SaveState(state)) {
+            return;
+        }
+
+        if (this->has_newest) {
+            /* The oldest slot is written again straight away, so it keeps its storage. */
+            if (this->count == this->deltas.size()) {
+                this->head = (this->head + 1) % this->deltas.size();
+                this->count--;
+            }
+
+            auto &slot = this->deltas[(this->head + this->count) % this->deltas.size()];
+
+            this->bytes -= slot.capacity();
+            CompressDelta(slot, this->newest, state);
+            this->bytes += slot.capacity();
+
+            this->count++;
+
+            while (this->bytes > this->byte_budget && this->count > 0) {
+                this->DropOldest();
+            }
+        }
+
+        this->newest     = state;
+        this->has_newest = true;
+    }
+
+    bool Rewind::StepBack(Chip8 &ch8, const std::size_t steps) {
+        if (!this->has_newest) {
+            return false;
+        }
+
+        for ([[maybe_unused]] const auto step : std::views::iota(std::size_t{0}, steps)) {
+            /* If the machine has moved on since the newest state, the first step just goes back to it. */
+            if (!this->at_newest) {
+                this->at_newest = true;
+                continue;
+            }
+
+            if (this->count == 0) {
+                break;
+            }
+
+            const auto newest_index = (this->head + this->count - 1) % this->deltas.size();
+            auto &delta             = this->deltas[newest_index];
+
+            ApplyDelta(this->newest, delta);
+
+            this->Release(delta);
+            this->count--;
+        }
+
+        this->frames_until_snapshot = this->interval - 1;
+
+        return ch8.LoadState(this->newest);
+    }
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "common.hpp"
+#include "util.hpp"
+#include "chip8.hpp"
+
+namespace tsh {
+
+    /*
+        Keeps a save state every few frames so play can be wound back.
+
+        Only the newest state is kept whole. Every older one is stored
+        as the XOR against the state after it, with runs of zeroes
+        squeezed out, so winding back is just XORing deltas in turn
+        and dropping the oldest snapshot never invalidates the rest.
+    */
+    class Rewind {
+        NON_COPYABLE(Rewind);
+        NON_MOVEABLE(Rewind);
+
+        public:
+            using State = std::array<std::byte, Chip8::StateSize>;
+
+            static constexpr std::size_t DefaultInterval = 6;
+
+            /* Three minutes of snapshots at the default interval. */
+            static constexpr std::size_t DefaultCapacity = 3 * 60 * 60 / DefaultInterval;
+
+            /* Hard limit on the bytes held by deltas, however badly they compress. */
+            static constexpr std::size_t DefaultByteBudget = 4 * 1024 * 1024;
+
+            std::size_t interval;
+            std::size_t byte_budget;
+
+            /* Ring of compressed deltas, oldest at head. Only slots holding a delta keep any storage. */
+            std::vector<std::vector<std::byte>> deltas;
+            std::size_t head  = 0;
+            std::size_t count = 0;
+
+            /* Capacity of every slot, which is what the budget is held to. */
+            std::size_t bytes = 0;
+
+            State newest = {};
+            bool has_newest = false;
+
+            /* Whether the machine was last wound back to the newest state. */
+            bool at_newest = false;
+
+            std::size_t frames_until_snapshot = 0;
+
+            explicit Rewind(const std::size_t interval = DefaultInterval, const std::size_t capacity = DefaultCapacity, const std::size_t byte_budget = DefaultByteBudget);
+
+            [[nodiscard]]
+            ALWAYS_INLINE std::size_t Snapshots() const {
+                return this->count + (this->has_newest ? 1 : 0);
+            }
+
+            /* Call once per frame. Takes a snapshot every interval frames. */
+            void OnFrame(const Chip8 &ch8);
+
+            /* Winds the machine back by some number of snapshots, forgetting them. */
+            bool StepBack(Chip8 &ch8, std::size_t steps = 1);
+
+            static void CompressDelta(std::vector<std::byte> &out, const State &older, const State &newer);
+            static void ApplyDelta(State &state, const std::span<const std::byte> delta);
+
+            /* Frees the slot's storage along with its delta. */
+            void Release(std::vector<std::byte> &slot);
+
+            void DropOldest();
+    };
+
+}
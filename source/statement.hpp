@@ -0,0 +1,169 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace tsh {
+
+    /*
+        One line of assembly, split once into its mnemonic and its
+        comma separated operands. Everything is a view into the line.
+    */
+    class Statement {
+        public:
+            static constexpr std::size_t MaxOperands = 3;
+
+            static constexpr char Wildcard = '*';
+
+            using Captures = std::array<std::string_view, MaxOperands>;
+
+            std::string_view mnemonic;
+
+            Captures operands = {};
+            std::size_t operand_count = 0;
+
+            ALWAYS_INLINE constexpr Statement() = default;
+
+            /* Compares the text of each piece, not where it lives. */
+            constexpr bool operator ==(const Statement &) const = default;
+
+            [[nodiscard]]
+            static constexpr bool IsSpace(const char c) {
+                return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+            }
+
+            [[nodiscard]]
+            static constexpr std::string_view Trim(std::string_view str) {
+                while (!str.empty() && IsSpace(str.front())) {
+                    str.remove_prefix(1);
+                }
+
+                while (!str.empty() && IsSpace(str.back())) {
+                    str.remove_suffix(1);
+                }
+
+                return str;
+            }
+
+            /* Fails for empty lines and lines with too many operands. Commas inside quotes don't split operands. */
+            [[nodiscard]]
+            static constexpr std::optional<Statement> Lex(std::string_view line) {
+                line = Trim(line);
+                if (line.empty()) {
+                    return {};
+                }
+
+                Statement statement;
+
+                const auto mnemonic_end = std::ranges::find_if(line, IsSpace) - line.begin();
+                statement.mnemonic = line.substr(0, mnemonic_end);
+
+                auto rest = Trim(line.substr(mnemonic_end));
+                if (rest.empty()) {
+                    return statement;
+                }
+
+                bool quoted = false;
+                std::size_t start = 0;
+                for (const auto i : std::views::iota(std::size_t{0}, rest.size() + 1)) {
+                    if (i < rest.size()) {
+                        if (rest[i] == '"') {
+                            quoted = !quoted;
+                        }
+
+                        if (rest[i] != ',' || quoted) {
+                            continue;
+                        }
+                    }
+
+                    if (statement.operand_count == MaxOperands) {
+                        return {};
+                    }
+
+                    statement.operands[statement.operand_count] = Trim(rest.substr(start, i - start));
+                    statement.operand_count++;
+
+                    start = i + 1;
+                }
+
+                return statement;
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr bool IsLabel() const {
+                return this->operand_count == 0 && this->mnemonic.size() > 1 && this->mnemonic.ends_with(':');
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr std::string_view Label() const {
+                return this->mnemonic.substr(0, this->mnemonic.size() - 1);
+            }
+
+            /* A pattern holds at most one wildcard, which has to match at least one character. */
+            [[nodiscard]]
+            static constexpr std::optional<std::string_view> MatchOperand(const std::string_view pattern, const std::string_view operand) {
+                const auto wildcard = pattern.find(Wildcard);
+                if (wildcard == std::string_view::npos) {
+                    if (pattern != operand) {
+                        return {};
+                    }
+
+                    return std::string_view();
+                }
+
+                const auto prefix = pattern.substr(0, wildcard);
+                const auto suffix = pattern.substr(wildcard + 1);
+
+                if (operand.size() <= prefix.size() + suffix.size() || !operand.starts_with(prefix) || !operand.ends_with(suffix)) {
+                    return {};
+                }
+
+                return operand.substr(prefix.size(), operand.size() - prefix.size() - suffix.size());
+            }
+
+            /*
+                Matches the mnemonic and then each operand against its pattern,
+                giving back what every wildcard matched in order.
+            */
+            template<std::convertible_to<std::string_view>... Patterns> requires (sizeof...(Patterns) <= MaxOperands)
+            [[nodiscard]]
+            constexpr std::optional<Captures> Match(const std::string_view mnemonic, const Patterns &... patterns) const {
+                if (this->mnemonic != mnemonic || this->operand_count != sizeof...(Patterns)) {
+                    return {};
+                }
+
+                Captures captures = {};
+                std::size_t capture_count = 0;
+
+                std::size_t operand = 0;
+                [[maybe_unused]] const auto match_one = [&](const std::string_view pattern) {
+                    const auto capture = MatchOperand(pattern, this->operands[operand]);
+                    operand++;
+
+                    if (!capture.has_value()) {
+                        return false;
+                    }
+
+                    if (pattern.find(Wildcard) != std::string_view::npos) {
+                        captures[capture_count] = *capture;
+                        capture_count++;
+                    }
+
+                    return true;
+                };
+
+                if (!(match_one(patterns) && ...)) {
+                    return {};
+                }
+
+                return captures;
+            }
+    };
+
+    static_assert(Statement::Lex("LD V1, 0x20")->mnemonic == "LD");
+    static_assert(Statement::Lex("LD V1, 0x20")->operands[1] == "0x20");
+    static_assert(Statement::Lex(".sprite \" *, * \"")->operand_count == 1);
+    static_assert(Statement::Lex("DRW V0, V1, 5")->Match("DRW", "V*", "V*", "*")->at(2) == "5");
+    static_assert(!Statement::Lex("LD V1, [I]")->Match("LD", "V*", "DT").has_value());
+    static_assert(Statement::Lex("loop:")->IsLabel());
+
+}
@@ -1,8 +1,115 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "common.hpp"
 #include "util.hpp"
 
 namespace tsh::util {
 
+    namespace {
+
+        constexpr std::uint64_t Prime1 = 0x9E3779B185EBCA87;
+        constexpr std::uint64_t Prime2 = 0xC2B2AE3D27D4EB4F;
+        constexpr std::uint64_t Prime3 = 0x165667B19E3779F9;
+        constexpr std::uint64_t Prime4 = 0x85EBCA77C2B2AE63;
+        constexpr std::uint64_t Prime5 = 0x27D4EB2F165667C5;
+
+        ALWAYS_INLINE std::uint64_t ReadLE64(const std::byte *data) {
+            std::uint64_t value;
+            std::memcpy(&value, data, sizeof(value));
+
+            if constexpr (std::endian::native == std::endian::big) {
+                value = __builtin_bswap64(value);
+            }
+
+            return value;
+        }
+
+        ALWAYS_INLINE std::uint32_t ReadLE32(const std::byte *data) {
+            std::uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+
+            if constexpr (std::endian::native == std::endian::big) {
+                value = __builtin_bswap32(value);
+            }
+
+            return value;
+        }
+
+        ALWAYS_INLINE constexpr std::uint64_t Round(std::uint64_t acc, const std::uint64_t input) {
+            acc += input * Prime2;
+            acc  = std::rotl(acc, 31);
+
+            return acc * Prime1;
+        }
+
+        ALWAYS_INLINE constexpr std::uint64_t MergeRound(std::uint64_t acc, const std::uint64_t value) {
+            acc ^= Round(0, value);
+
+            return acc * Prime1 + Prime4;
+        }
+
+    }
+
+    std::uint64_t Hash64(const std::span<const std::byte> data, const std::uint64_t seed) {
+        auto ptr       = data.data();
+        const auto end = ptr + data.size();
+
+        std::uint64_t hash;
+
+        if (data.size() >= 32) {
+            auto v1 = seed + Prime1 + Prime2;
+            auto v2 = seed + Prime2;
+            auto v3 = seed;
+            auto v4 = seed - Prime1;
+
+            /* Four independent lanes so the stripes pipeline nicely. */
+            for (; end - ptr >= 32; ptr += 32) {
+                v1 = Round(v1, ReadLE64(ptr +  0));
+                v2 = Round(v2, ReadLE64(ptr +  8));
+                v3 = Round(v3, ReadLE64(ptr + 16));
+                v4 = Round(v4, ReadLE64(ptr + 24));
+            }
+
+            hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+            hash = MergeRound(hash, v1);
+            hash = MergeRound(hash, v2);
+            hash = MergeRound(hash, v3);
+            hash = MergeRound(hash, v4);
+        } else {
+            hash = seed + Prime5;
+        }
+
+        hash += data.size();
+
+        for (; end - ptr >= 8; ptr += 8) {
+            hash ^= Round(0, ReadLE64(ptr));
+            hash  = std::rotl(hash, 27) * Prime1 + Prime4;
+        }
+
+        if (end - ptr >= 4) {
+            hash ^= ReadLE32(ptr) * Prime1;
+            hash  = std::rotl(hash, 23) * Prime2 + Prime3;
+
+            ptr += 4;
+        }
+
+        for (; ptr < end; ptr++) {
+            hash ^= std::to_integer<std::uint64_t>(*ptr) * Prime5;
+            hash  = std::rotl(hash, 11) * Prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
+
     std::optional<std::vector<std::string_view>> WildcardCapture(const std::string_view pattern, const std::string_view str) {
         static constexpr char WildcardChar = '*';
 
@@ -94,4 +201,218 @@ namespace tsh::util {
         return true;
     }
 
+    bool MappedFile::Open(const std::string &path) {
+        this->Close();
+
+        const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        /* The mapping stays valid after the descriptor is closed. */
+        ON_SCOPE_EXIT { ::close(fd); };
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            return false;
+        }
+
+        const auto size = static_cast<std::size_t>(info.st_size);
+
+        /* Zero-length mappings aren't allowed, but an empty view is fine. */
+        if (size == 0) {
+            return true;
+        }
+
+        const auto mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+
+        this->data = static_cast<const std::byte *>(mapped);
+        this->size = size;
+
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (this->data != nullptr) {
+            ::munmap(const_cast<std::byte *>(this->data), this->size);
+        }
+
+        this->data = nullptr;
+        this->size = 0;
+    }
+
+    ThreadPool::ThreadPool(const std::size_t threads) {
+        const auto count = (threads != 0) ? threads : std::max(1u, std::thread::hardware_concurrency());
+
+        for ([[maybe_unused]] const auto i : std::views::iota(std::size_t{0}, count)) {
+            this->queues.push_back(std::make_unique<Queue>());
+        }
+
+        for (const auto worker : std::views::iota(std::size_t{0}, count)) {
+            this->workers.emplace_back([this, worker](const std::stop_token token) {
+                this->WorkerLoop(token, worker);
+            });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        for (auto &worker : this->workers) {
+            worker.request_stop();
+        }
+
+        this->signal.fetch_add(1, std::memory_order_release);
+        this->signal.notify_all();
+
+        /* Join before the queues go away. */
+        this->workers.clear();
+    }
+
+    void ThreadPool::Submit(Task task) {
+        auto &queue = *this->queues[this->next_queue.fetch_add(1, std::memory_order_relaxed) % this->queues.size()];
+
+        this->pending.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            const auto lock = std::scoped_lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        this->signal.fetch_add(1, std::memory_order_release);
+        this->signal.notify_one();
+    }
+
+    void ThreadPool::Wait() {
+        while (true) {
+            const auto left = this->pending.load(std::memory_order_acquire);
+            if (left == 0) {
+                break;
+            }
+
+            this->pending.wait(left, std::memory_order_acquire);
+        }
+    }
+
+    bool ThreadPool::RunOne(const std::size_t worker) {
+        Task task;
+
+        /* Our own newest task first, then the oldest of everyone else's. */
+        for (const auto i : std::views::iota(std::size_t{0}, this->queues.size())) {
+            auto &queue = *this->queues[(worker + i) % this->queues.size()];
+
+            const auto lock = std::scoped_lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+
+            break;
+        }
+
+        if (!task) {
+            return false;
+        }
+
+        task();
+
+        if (this->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->pending.notify_all();
+        }
+
+        return true;
+    }
+
+    void ThreadPool::WorkerLoop(const std::stop_token token, const std::size_t worker) {
+        while (!token.stop_requested()) {
+            /* Read before looking for work, so anything submitted after we find none still wakes us. */
+            const auto seen = this->signal.load(std::memory_order_acquire);
+
+            if (this->RunOne(worker)) {
+                continue;
+            }
+
+            /* A stop landing after the loop condition bumped signal before we read it, so it will not wake us. */
+            if (token.stop_requested()) {
+                break;
+            }
+
+            this->signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    std::optional<std::vector<std::byte>> ReadFromFile(const std::string &path) {
+        const auto fp = std::fopen(path.c_str(), "rb");
+        if (fp == nullptr) {
+            return {};
+        }
+
+        ON_SCOPE_EXIT { std::fclose(fp); };
+
+        if (std::fseek(fp, 0, SEEK_END) != 0) {
+            return {};
+        }
+
+        const auto offset = std::ftell(fp);
+        if (offset < 0) {
+            return {};
+        }
+
+        if (std::fseek(fp, 0, SEEK_SET) != 0) {
+            return {};
+        }
+
+        auto data = std::vector<std::byte>(static_cast<std::size_t>(offset));
+        if (!data.empty() && std::fread(data.data(), data.size(), 1, fp) != 1) {
+            return {};
+        }
+
+        return data;
+    }
+
+    bool WriteHashList(const std::string &path, const std::span<const std::uint64_t> hashes) {
+        const auto fp = std::fopen(path.c_str(), "w");
+        if (fp == nullptr) {
+            return false;
+        }
+
+        ON_SCOPE_EXIT { std::fclose(fp); };
+
+        for (const auto &hash : hashes) {
+            fmt::print(fp, "{:016x}\n", hash);
+        }
+
+        return std::ferror(fp) == 0;
+    }
+
+    std::optional<std::vector<std::uint64_t>> ReadHashList(const std::string &path) {
+        const auto fp = std::fopen(path.c_str(), "r");
+        if (fp == nullptr) {
+            return {};
+        }
+
+        ON_SCOPE_EXIT { std::fclose(fp); };
+
+        std::vector<std::uint64_t> hashes;
+
+        unsigned long long hash;
+        while (std::fscanf(fp, "%llx", &hash) == 1) {
+            hashes.push_back(hash);
+        }
+
+        if (!std::feof(fp)) {
+            return {};
+        }
+
+        return hashes;
+    }
+
 }
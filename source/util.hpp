@@ -91,6 +91,145 @@ namespace tsh::util {
     requires std::same_as<Value, typename FirstEntry::second_type>
     Map(Value, FirstEntry, Entries...) -> Map<typename FirstEntry::first_type, Value, sizeof...(Entries) + 1>;
 
+    template<typename T>
+    concept DenseKey = std::integral<T> || std::is_enum_v<T>;
+
+    /* Negative values wrap around to huge indices, which every range check then rejects. */
+    template<DenseKey T>
+    ALWAYS_INLINE constexpr std::size_t DenseIndex(const T value) {
+        if constexpr (std::is_enum_v<T>) {
+            return static_cast<std::size_t>(static_cast<std::underlying_type_t<T>>(value));
+        } else {
+            return static_cast<std::size_t>(value);
+        }
+    }
+
+    /*
+        Lookup tables in both directions for keys and values
+        which densely cover [0, KeyRange) and [0, ValueRange).
+        Keys and values are kept one-to-one.
+    */
+    template<DenseKey Key, DenseKey Value, std::size_t KeyRange, std::size_t ValueRange>
+    class DenseMap {
+        public:
+            Value default_value;
+
+            std::array<Value, KeyRange> values = {};
+            std::array<std::optional<Key>, ValueRange> keys = {};
+
+            explicit constexpr DenseMap(const Value &default_value) : default_value(default_value) {
+                std::ranges::fill(this->values, default_value);
+            }
+
+            template<std::size_t N>
+            explicit constexpr DenseMap(const Map<Key, Value, N> &map) : DenseMap(map.default_value) {
+                for (const auto &[key, value] : map) {
+                    if (!this->Set(key, value)) {
+                        ERROR("Map entry out of range for DenseMap");
+                    }
+                }
+            }
+
+            [[nodiscard]]
+            constexpr bool Set(const Key &key, const Value &value) {
+                const auto key_index   = DenseIndex(key);
+                const auto value_index = DenseIndex(value);
+
+                if (key_index >= KeyRange || value_index >= ValueRange) {
+                    return false;
+                }
+
+                /* Unhook whatever either side was previously paired with. */
+                const auto old_value_index = DenseIndex(this->values[key_index]);
+                if (old_value_index < ValueRange && this->keys[old_value_index] == key) {
+                    this->keys[old_value_index].reset();
+                }
+
+                const auto old_key = this->keys[value_index];
+                if (old_key.has_value()) {
+                    this->values[DenseIndex(*old_key)] = this->default_value;
+                }
+
+                this->values[key_index] = value;
+                this->keys[value_index] = key;
+
+                return true;
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr std::optional<Key> KeyForValue(const Value &to_find) const {
+                const auto index = DenseIndex(to_find);
+                if (index >= ValueRange) {
+                    return {};
+                }
+
+                return this->keys[index];
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr const Value &operator [](const Key &to_find) const {
+                const auto index = DenseIndex(to_find);
+                if (index >= KeyRange) {
+                    return this->default_value;
+                }
+
+                return this->values[index];
+            }
+    };
+
+    /* A stack which never allocates, for when the deepest it may get is known. */
+    template<typename T, std::size_t N>
+    class FixedStack {
+        public:
+            std::array<T, N> entries = {};
+            std::size_t depth = 0;
+
+            ALWAYS_INLINE constexpr FixedStack() = default;
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr bool Push(const T &value) {
+                if (this->depth == N) {
+                    return false;
+                }
+
+                this->entries[this->depth] = value;
+                this->depth++;
+
+                return true;
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr std::optional<T> Pop() {
+                if (this->depth == 0) {
+                    return {};
+                }
+
+                this->depth--;
+
+                return this->entries[this->depth];
+            }
+
+            ALWAYS_INLINE constexpr void Clear() {
+                this->depth = 0;
+            }
+
+            ALWAYS_INLINE constexpr auto begin() const {
+                return this->entries.begin();
+            }
+
+            ALWAYS_INLINE constexpr auto end() const {
+                return this->entries.begin() + this->depth;
+            }
+
+            ALWAYS_INLINE constexpr std::size_t size() const {
+                return this->depth;
+            }
+
+            ALWAYS_INLINE static constexpr std::size_t capacity() {
+                return N;
+            }
+    };
+
     template<std::integral T>
     constexpr T pow(const T base, const std::size_t power) {
         if (base == 0) {
@@ -104,10 +243,308 @@ namespace tsh::util {
         return base * pow(base, power - 1);
     }
 
+    /*
+        Bounded single-producer, single-consumer ring. Neither
+        side ever blocks; a full ring simply refuses the push.
+    */
+    template<typename T, std::size_t N> requires (std::has_single_bit(N))
+    class SpscRing {
+        NON_COPYABLE(SpscRing);
+        NON_MOVEABLE(SpscRing);
+
+        public:
+            static constexpr std::size_t CacheLineSize = 64;
+
+            std::array<T, N> slots = {};
+
+            /* Kept on separate cache lines so the two sides don't fight over them. */
+            alignas(CacheLineSize) std::atomic<std::size_t> head = 0;
+            alignas(CacheLineSize) std::atomic<std::size_t> tail = 0;
+
+            ALWAYS_INLINE constexpr SpscRing() = default;
+
+            [[nodiscard]]
+            bool TryPush(const T &value) {
+                const auto cur_head = this->head.load(std::memory_order_relaxed);
+                if (cur_head - this->tail.load(std::memory_order_acquire) == N) {
+                    return false;
+                }
+
+                this->slots[cur_head % N] = value;
+                this->head.store(cur_head + 1, std::memory_order_release);
+
+                return true;
+            }
+
+            [[nodiscard]]
+            bool TryPop(T &out) {
+                const auto cur_tail = this->tail.load(std::memory_order_relaxed);
+                if (cur_tail == this->head.load(std::memory_order_acquire)) {
+                    return false;
+                }
+
+                out = this->slots[cur_tail % N];
+                this->tail.store(cur_tail + 1, std::memory_order_release);
+
+                return true;
+            }
+    };
+
+    /*
+        Lets one writer keep publishing values while one reader picks
+        up the latest of them, without either side ever waiting.
+    */
+    template<typename T>
+    class TripleBuffer {
+        NON_COPYABLE(TripleBuffer);
+        NON_MOVEABLE(TripleBuffer);
+
+        public:
+            static constexpr std::uint8_t IndexMask = 0b011;
+            static constexpr std::uint8_t FreshBit  = 0b100;
+
+            std::array<T, 3> buffers = {};
+
+            /* Owned by the writer. */
+            std::uint8_t back = 0;
+
+            /* Swapped between the two sides, marked fresh when the writer leaves something new in it. */
+            std::atomic<std::uint8_t> middle = 1;
+
+            /* Owned by the reader. */
+            std::uint8_t front = 2;
+
+            ALWAYS_INLINE constexpr TripleBuffer() = default;
+
+            void Publish(const T &value) {
+                this->buffers[this->back] = value;
+
+                this->back = this->middle.exchange(this->back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+            }
+
+            [[nodiscard]]
+            const T &Latest() {
+                if ((this->middle.load(std::memory_order_relaxed) & FreshBit) != 0) {
+                    this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & IndexMask;
+                }
+
+                return this->buffers[this->front];
+            }
+    };
+
+    /* Writes little-endian values into a fixed buffer, remembering if anything didn't fit. */
+    class ByteWriter {
+        public:
+            std::span<std::byte> out;
+            std::size_t offset = 0;
+            bool overflowed    = false;
+
+            ALWAYS_INLINE constexpr explicit ByteWriter(const std::span<std::byte> out) : out(out) { }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr bool Ok() const {
+                return !this->overflowed;
+            }
+
+            constexpr void WriteBytes(const std::span<const std::byte> data) {
+                if (this->out.size() - this->offset < data.size()) {
+                    this->overflowed = true;
+                    return;
+                }
+
+                std::ranges::copy(data, this->out.begin() + this->offset);
+                this->offset += data.size();
+            }
+
+            template<std::integral T>
+            constexpr void Write(const T value) {
+                std::array<std::byte, sizeof(T)> bytes;
+                for (const auto i : std::views::iota(std::size_t{0}, sizeof(T))) {
+                    bytes[i] = static_cast<std::byte>(static_cast<std::make_unsigned_t<T>>(value) >> (BITSIZEOF(std::byte) * i));
+                }
+
+                this->WriteBytes(bytes);
+            }
+
+            /* LEB128, for counts which are usually small. */
+            constexpr void WriteVarint(std::uint64_t value) {
+                do {
+                    auto byte = static_cast<std::uint8_t>(value & 0x7F);
+                    value >>= 7;
+
+                    if (value != 0) {
+                        byte |= 0x80;
+                    }
+
+                    this->Write(byte);
+                } while (value != 0);
+            }
+    };
+
+    /* Reads what ByteWriter writes, remembering if the data ran out. */
+    class ByteReader {
+        public:
+            std::span<const std::byte> in;
+            std::size_t offset = 0;
+            bool underflowed   = false;
+
+            ALWAYS_INLINE constexpr explicit ByteReader(const std::span<const std::byte> in) : in(in) { }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr bool Ok() const {
+                return !this->underflowed;
+            }
+
+            [[nodiscard]]
+            ALWAYS_INLINE constexpr bool AtEnd() const {
+                return this->offset == this->in.size();
+            }
+
+            constexpr void ReadBytes(const std::span<std::byte> data) {
+                if (this->in.size() - this->offset < data.size()) {
+                    this->underflowed = true;
+                    return;
+                }
+
+                std::ranges::copy(this->in.subspan(this->offset, data.size()), data.begin());
+                this->offset += data.size();
+            }
+
+            constexpr void Skip(const std::size_t size) {
+                if (this->in.size() - this->offset < size) {
+                    this->underflowed = true;
+                    return;
+                }
+
+                this->offset += size;
+            }
+
+            template<std::integral T>
+            [[nodiscard]]
+            constexpr T Read() {
+                std::array<std::byte, sizeof(T)> bytes = {};
+                this->ReadBytes(bytes);
+
+                std::make_unsigned_t<T> value = 0;
+                for (const auto i : std::views::iota(std::size_t{0}, sizeof(T))) {
+                    value |= static_cast<std::make_unsigned_t<T>>(std::to_integer<std::make_unsigned_t<T>>(bytes[i]) << (BITSIZEOF(std::byte) * i));
+                }
+
+                return static_cast<T>(value);
+            }
+
+            [[nodiscard]]
+            constexpr std::uint64_t ReadVarint() {
+                std::uint64_t value = 0;
+
+                for (std::size_t shift = 0; shift < BITSIZEOF(value); shift += 7) {
+                    const auto byte = this->Read<std::uint8_t>();
+                    value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+
+                    if ((byte & 0x80) == 0) {
+                        return value;
+                    }
+                }
+
+                /* Too long to be something we wrote. */
+                this->underflowed = true;
+                return 0;
+            }
+    };
+
+    /* A read-only view of a whole file, mapped rather than read. */
+    class MappedFile {
+        NON_COPYABLE(MappedFile);
+        NON_MOVEABLE(MappedFile);
+
+        public:
+            const std::byte *data = nullptr;
+            std::size_t size      = 0;
+
+            ALWAYS_INLINE MappedFile() = default;
+
+            ALWAYS_INLINE ~MappedFile() {
+                this->Close();
+            }
+
+            /* Fails for anything which can't be mapped, e.g. pipes. */
+            [[nodiscard]]
+            bool Open(const std::string &path);
+
+            void Close();
+
+            [[nodiscard]]
+            ALWAYS_INLINE std::span<const std::byte> Span() const {
+                return std::span(this->data, this->size);
+            }
+    };
+
+    /*
+        A fixed set of workers, each with their own queue of tasks.
+        Workers take their newest task first and steal the oldest
+        from one another once their own queue runs dry, so uneven
+        tasks still keep every core busy.
+    */
+    class ThreadPool {
+        NON_COPYABLE(ThreadPool);
+        NON_MOVEABLE(ThreadPool);
+
+        public:
+            using Task = std::function<void()>;
+
+            struct Queue {
+                std::mutex mutex;
+                std::deque<Task> tasks;
+            };
+
+            /* One per worker, never resized once the workers are running. */
+            std::vector<std::unique_ptr<Queue>> queues;
+            std::vector<std::jthread> workers;
+
+            /* Bumped whenever there might be new work or the workers should stop. */
+            std::atomic<std::uint32_t> signal = 0;
+
+            /* Tasks submitted but not yet finished. */
+            std::atomic<std::size_t> pending = 0;
+
+            /* Spreads submitted tasks across the queues. */
+            std::atomic<std::size_t> next_queue = 0;
+
+            /* Zero threads means one per core. */
+            explicit ThreadPool(const std::size_t threads = 0);
+
+            ~ThreadPool();
+
+            [[nodiscard]]
+            ALWAYS_INLINE std::size_t size() const {
+                return this->workers.size();
+            }
+
+            void Submit(Task task);
+
+            /* Blocks until every submitted task has finished. */
+            void Wait();
+
+            [[nodiscard]]
+            bool RunOne(const std::size_t worker);
+
+            void WorkerLoop(const std::stop_token token, const std::size_t worker);
+    };
+
+    /* XXH64, so hashes can be checked against other tools. */
+    std::uint64_t Hash64(const std::span<const std::byte> data, const std::uint64_t seed = 0);
+
     std::optional<std::vector<std::string_view>> WildcardCapture(const std::string_view pattern, const std::string_view str);
 
     bool WriteToFile(const std::string &path, const std::span<const std::byte> data);
 
+    std::optional<std::vector<std::byte>> ReadFromFile(const std::string &path);
+
+    /* Hash lists are stored as text, one hex hash per line, so they diff nicely. */
+    bool WriteHashList(const std::string &path, const std::span<const std::uint64_t> hashes);
+
+    std::optional<std::vector<std::uint64_t>> ReadHashList(const std::string &path);
+
     /* From Atmosphere, which is from another person. */
     template<class F>
     class ScopeGuard {